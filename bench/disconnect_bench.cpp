@@ -0,0 +1,247 @@
+/**
+ * @file disconnect_bench.cpp
+ * @brief Mass disconnect: 10k users spread over 50k channels.
+ *
+ * Compares Server::removeClient (driven by each client's joined list and
+ * the per-nick invite index) with the previous teardown, which scanned
+ * every channel twice plus once more for invites.
+ *
+ * Also checks that a pooled Client slot handed to a new connection
+ * inherits no channel status from its previous occupant; a failure exits
+ * non-zero so make bench stops.
+ *
+ * Usage: make bench (builds with -O2 and runs every benchmark)
+ */
+
+#include "../includes/Casemap.hpp"
+#include "../includes/Channel.hpp"
+#include "../includes/Client.hpp"
+#include "../includes/ObjectPool.hpp"
+#include "../includes/Reactor.hpp"
+#include "../includes/Server.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const size_t USERS = 10000;
+static const size_t CHANNELS = 50000;
+static const size_t JOINS_PER_USER = 25; // ~5 members per channel
+static const size_t INVITES_PER_USER = 2;
+static const size_t LEGACY_SAMPLE = 200; // a full legacy run takes minutes
+static const int FIRST_FD = 100000;       // never a real descriptor
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Friend of Server: builds state and tears it down without sockets.
+ */
+struct ServerBench {
+  Server server;
+  Reactor owner; // never started; releaseClient() ignores our fake fds
+  std::vector<Client *> clients;
+
+  ServerBench() : server("0", "pw"), owner(&server, 0) {
+    unsigned long seed = 42;
+    for (size_t i = 0; i < USERS; ++i) {
+      Client *c = new Client(FIRST_FD + static_cast<int>(i));
+      c->setId(i + 1);
+      c->setOwner(&owner);
+      server._clients.set(c->getFd(), c);
+      server.setClientNick(c, "user" + std::to_string(i));
+      clients.push_back(c);
+
+      for (size_t j = 0; j < JOINS_PER_USER; ++j) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        join(c, (i * JOINS_PER_USER + j) % CHANNELS, seed);
+      }
+      for (size_t j = 0; j < INVITES_PER_USER; ++j) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        std::map<std::string, Channel *>::iterator it =
+            server._channels.find(channelName((seed >> 17) % CHANNELS));
+        if (it != server._channels.end())
+          server.addInvite(it->second, c);
+      }
+    }
+  }
+
+  ~ServerBench() {
+    for (size_t i = 0; i < clients.size(); ++i)
+      delete clients[i];
+    server._clients.clear(); // owned by us, not by a reactor
+  }
+
+  static std::string channelName(size_t n) {
+    return "#chan" + std::to_string(n);
+  }
+
+  void join(Client *c, size_t base, unsigned long seed) {
+    // a fifth of the joins walk the channel list so it stays dense, the
+    // rest pick a random channel
+    size_t n = (seed >> 33) % 5 == 0 ? base : (seed >> 17) % CHANNELS;
+    Channel *ch = server.getOrCreateChannel(channelName(n));
+    if (ch->hasClient(c))
+      return;
+    ch->addClient(c);
+    c->joinChannel(ch);
+    if (ch->getClients().size() == 1)
+      ch->addOperator(c);
+  }
+
+  /* The teardown removeClient() used before the joined-list index */
+  void legacyRemove(int fd) {
+    Client *client = server._clients.get(fd);
+    std::string nick = client->getNickname();
+    for (int pass = 0; pass < 2; ++pass) {
+      std::map<std::string, Channel *>::iterator it = server._channels.begin();
+      while (it != server._channels.end()) {
+        Channel *channel = it->second;
+        if (channel->hasClient(client)) {
+          channel->removeClient(client);
+          client->leaveChannel(channel);
+          if (channel->getClients().empty()) {
+            server._channelPool.destroy(channel);
+            server._channelIndex.erase(it->first);
+            server._channels.erase(it++);
+            continue;
+          }
+        }
+        ++it;
+      }
+    }
+    for (std::map<std::string, Channel *>::iterator it =
+             server._channels.begin();
+         it != server._channels.end(); ++it)
+      it->second->removeInvited(client);
+    server._nicks.erase(ircCasefold(nick));
+    server._clients.erase(fd);
+  }
+
+  /**
+   * @brief Regression: status must not follow a reused pool slot.
+   *
+   * bob is opped on #x and quits; mallory gets bob's address from the pool
+   * and joins #x. Then the same reuse with a record deliberately left
+   * behind, which the id stored in each MemberTable record must hide.
+   */
+  static bool checkSlotReuse() {
+    Server server("0", "pw");
+    Reactor owner(&server, 0); // never started; our fds are fake
+    ObjectPool<Client> pool;
+
+    Client *alice = pool.create(FIRST_FD);
+    Client *bob = pool.create(FIRST_FD + 1);
+    alice->setOwner(&owner);
+    bob->setOwner(&owner);
+    server.registerClient(alice);
+    server.registerClient(bob);
+    server.setClientNick(alice, "alice");
+    server.setClientNick(bob, "bob");
+
+    Channel *ch = server.getOrCreateChannel("#x");
+    ch->addClient(alice);
+    alice->joinChannel(ch);
+    ch->addOperator(alice);
+    if (ch->addOperator(bob)) // +o on a non-member
+      return false;
+    ch->addClient(bob);
+    bob->joinChannel(ch);
+    ch->addOperator(bob);
+    server.addInvite(server.getOrCreateChannel("#y"), bob);
+
+    Client *slot = bob;
+    {
+      std::unique_lock<std::shared_mutex> lock(server._stateLock);
+      server.removeClient(bob->getFd());
+    }
+    pool.destroy(bob);
+    Client *mallory = pool.create(FIRST_FD + 1);
+    if (mallory != slot)
+      return false; // the pool no longer reuses slots; nothing to check
+    mallory->setOwner(&owner);
+    server.registerClient(mallory);
+    server.setClientNick(mallory, "mallory");
+    ch->addClient(mallory);
+    mallory->joinChannel(ch);
+
+    bool ok = !ch->isOperator(mallory) && ch->getClients().size() == 2 &&
+              server._channels.count("#y") &&
+              !server._channels["#y"]->isInvited(mallory);
+
+    // A record the teardown missed must stay invisible to the next holder
+    MemberTable table;
+    Client *eve = pool.create(FIRST_FD + 2);
+    eve->setId(1000);
+    table.add(eve);
+    table.setFlags(eve, MemberTable::OPERATOR);
+    pool.destroy(eve);
+    Client *trent = pool.create(FIRST_FD + 2);
+    trent->setId(1001);
+    ok = ok && trent == eve && !table.contains(trent) &&
+         !table.hasFlags(trent, MemberTable::OPERATOR) && table.add(trent) &&
+         table.size() == 1 && table.flagsOf(trent) == MemberTable::MEMBER;
+    table.remove(trent);
+    pool.destroy(trent);
+
+    {
+      std::unique_lock<std::shared_mutex> lock(server._stateLock);
+      server.removeClient(mallory->getFd());
+      server.removeClient(alice->getFd());
+    }
+    pool.destroy(mallory);
+    pool.destroy(alice);
+    return ok;
+  }
+
+  size_t channelCount() const { return server._channels.size(); }
+
+  double run(size_t count, bool legacy) {
+    std::unique_lock<std::shared_mutex> lock(server._stateLock);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+      if (legacy)
+        legacyRemove(clients[i]->getFd());
+      else
+        server.removeClient(clients[i]->getFd());
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start)
+        .count();
+  }
+};
+
+int main() {
+  // removeClient() logs every disconnect; keep the report readable
+  std::ostringstream discard;
+  std::streambuf *stdoutBuf = std::cout.rdbuf(discard.rdbuf());
+
+  double legacyUs, indexedUs;
+  size_t channelsBuilt, channelsLeft;
+  {
+    ServerBench bench;
+    legacyUs = bench.run(LEGACY_SAMPLE, true) / LEGACY_SAMPLE;
+  }
+  {
+    ServerBench bench;
+    channelsBuilt = bench.channelCount();
+    indexedUs = bench.run(USERS, false);
+    channelsLeft = bench.channelCount();
+  }
+  bool reuseOk = ServerBench::checkSlotReuse();
+  std::cout.rdbuf(stdoutBuf);
+
+  std::printf("disconnect/setup           %zu users, %zu channels\n", USERS,
+              channelsBuilt);
+  std::printf("disconnect/full-scan      %10.1f us/user (first %zu users)\n",
+              legacyUs, LEGACY_SAMPLE);
+  std::printf("disconnect/joined-index   %10.1f us/user\n",
+              indexedUs / USERS);
+  std::printf("disconnect/all-%zuk-users %10.1f ms total (%zu channels left)\n",
+              USERS / 1000, indexedUs / 1000, channelsLeft);
+  std::printf("disconnect/speedup        %10.1fx\n",
+              legacyUs / (indexedUs / USERS));
+  std::printf("disconnect/slot-reuse     %s\n", reuseOk ? "ok" : "FAILED");
+  return reuseOk ? 0 : 1;
+}
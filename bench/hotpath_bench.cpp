@@ -0,0 +1,595 @@
+/**
+ * @file hotpath_bench.cpp
+ * @brief Microbenchmarks for the functions every message passes through.
+ *
+ * Steps:
+ *  - Each case reports ns/op, allocations/op and allocated bytes/op
+ *    (operator new is replaced to count them)
+ *  - Cases: Parser::parse, InputBuffer line extraction, handleCommand
+ *    dispatch, Channel::broadcast at 10/1k/10k members,
+ *    Client::consumeBytes, splitCommaList, makeReply and the timer
+ *    wheel with 100k pending timers
+ *  - Text by default; --json prints one JSON document for diffing runs
+ *
+ * Usage: make bench, or make bench-json BENCH_JSON=results.json
+ *        obj/bench/hotpath_bench [--json] [--filter=SUBSTRING]
+ */
+
+#include "../includes/Channel.hpp"
+#include "../includes/Client.hpp"
+#include "../includes/CommandHandlerHelpers.hpp"
+#include "../includes/CommandTable.hpp"
+#include "../includes/InputBuffer.hpp"
+#include "../includes/Metrics.hpp"
+#include "../includes/Parser.hpp"
+#include "../includes/Reactor.hpp"
+#include "../includes/Replies.hpp"
+#include "../includes/Server.hpp"
+#include "../includes/TimerWheel.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* ============================= */
+/*       ALLOCATION COUNTING     */
+/* ============================= */
+
+static size_t g_allocs;
+static size_t g_allocBytes;
+
+void *operator new(size_t size) {
+  ++g_allocs;
+  g_allocBytes += size;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+// Out of line: once inlined, GCC flags the malloc/free pair behind new and
+// delete as mismatched
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  std::free(p);
+}
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+}
+
+/* ============================= */
+/*            HARNESS            */
+/* ============================= */
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile size_t g_sink; // keeps the optimizer from dropping the work
+
+/**
+ * @brief Accumulates time and allocations over the timed sections of a
+ * case, so untimed setup (refilling queues, clearing output) can sit
+ * between start() and stop() pairs.
+ */
+class Meter {
+public:
+  Meter() : _ns(0), _allocs(0), _bytes(0), _ops(0) {}
+
+  void start() {
+    _allocsAt = g_allocs;
+    _bytesAt = g_allocBytes;
+    _startAt = Clock::now();
+  }
+
+  void stop(size_t ops) {
+    Clock::time_point end = Clock::now();
+    _ns += std::chrono::duration<double, std::nano>(end - _startAt).count();
+    _allocs += g_allocs - _allocsAt;
+    _bytes += g_allocBytes - _bytesAt;
+    _ops += ops;
+  }
+
+  size_t ops() const { return _ops; }
+  double nsPerOp() const { return _ops ? _ns / _ops : 0; }
+  double allocsPerOp() const { return _ops ? double(_allocs) / _ops : 0; }
+  double bytesPerOp() const { return _ops ? double(_bytes) / _ops : 0; }
+
+private:
+  Clock::time_point _startAt;
+  size_t _allocsAt;
+  size_t _bytesAt;
+  double _ns;
+  size_t _allocs;
+  size_t _bytes;
+  size_t _ops;
+};
+
+struct Row {
+  std::string name;
+  Meter meter;
+};
+
+static std::vector<Row> g_rows;
+static std::string g_filter;
+
+static bool selected(const std::string &name) {
+  return g_filter.empty() || name.find(g_filter) != std::string::npos;
+}
+
+static void record(const std::string &name, const Meter &meter) {
+  Row row;
+  row.name = name;
+  row.meter = meter;
+  g_rows.push_back(row);
+}
+
+/* Times ops calls of fn in one stretch */
+template <typename Fn>
+static void measure(const std::string &name, size_t ops, const Fn &fn) {
+  if (!selected(name))
+    return;
+  size_t sink = 0;
+  Meter meter;
+  meter.start();
+  for (size_t i = 0; i < ops; ++i)
+    sink += fn(i);
+  meter.stop(ops);
+  g_sink = sink;
+  record(name, meter);
+}
+
+/* ============================= */
+/*          PARSE / LINES        */
+/* ============================= */
+
+static const char *CORPUS[] = {
+    "PRIVMSG #general :hello everyone, how is it going today?",
+    "PRIVMSG alice :a direct message with a few more words in it",
+    "PING irc.example.net",
+    "JOIN #general,#random key1,key2",
+    "MODE #general +o bob",
+    ":nick!user@host PRIVMSG #chan :prefixed message from a relay",
+    "@time=2024-01-01T00:00:00.000Z;msgid=abc PRIVMSG #c :tagged",
+    "USER guest 0 * :Real Name Here",
+};
+static const size_t CORPUS_SIZE = sizeof(CORPUS) / sizeof(CORPUS[0]);
+
+static void benchParse() {
+  std::string_view lines[CORPUS_SIZE];
+  for (size_t i = 0; i < CORPUS_SIZE; ++i)
+    lines[i] = CORPUS[i];
+  measure("parser/parse", 4000000, [&](size_t i) {
+    ParsedCommand cmd = Parser::parse(lines[i % CORPUS_SIZE]);
+    return cmd.params.size() + cmd.command.size();
+  });
+}
+
+/**
+ * @brief One op is one line taken out of the buffer; the append that a
+ * recv() would do is timed along with it.
+ */
+static void benchLines() {
+  if (!selected("input/nextLine"))
+    return;
+  std::string stream;
+  size_t perFill = 0;
+  while (stream.size() < 4000) {
+    stream.append(CORPUS[perFill % CORPUS_SIZE]).append("\r\n");
+    ++perFill;
+  }
+
+  InputBuffer input;
+  size_t sink = 0;
+  Meter meter;
+  for (size_t round = 0; round < 50000; ++round) {
+    meter.start();
+    input.append(stream.data(), stream.size());
+    std::string_view line;
+    while (input.nextLine(line))
+      sink += line.size();
+    meter.stop(perFill);
+  }
+  g_sink = sink;
+  record("input/nextLine", meter);
+}
+
+/* ============================= */
+/*            DISPATCH           */
+/* ============================= */
+
+static const int FIRST_FD = 100000; // never a real descriptor
+
+/**
+ * @brief Friend of Server: registered clients without sockets or reactors,
+ * so replies stay queued on the Client and are dropped between rounds.
+ */
+struct ServerBench {
+  Server server;
+  std::vector<Client *> clients;
+
+  ServerBench(size_t count) : server("0", "pw") {
+    for (size_t i = 0; i < count; ++i) {
+      Client *c = new Client(FIRST_FD + static_cast<int>(i));
+      server.registerClient(c);
+      clients.push_back(c);
+      std::string nick = "user" + std::to_string(i);
+      run(c, "PASS pw");
+      run(c, "NICK " + nick);
+      run(c, "USER " + nick + " 0 * :Bench User");
+      run(c, "JOIN #bench");
+    }
+    drain();
+  }
+
+  ~ServerBench() {
+    for (size_t i = 0; i < clients.size(); ++i)
+      delete clients[i];
+    server._clients.clear(); // owned by us, not by a reactor
+  }
+
+  void run(Client *c, std::string_view line) { server.handleCommand(c, line); }
+
+  void drain() {
+    for (size_t i = 0; i < clients.size(); ++i)
+      clients[i]->clearOutputBuffer();
+  }
+
+  /**
+   * @brief Checks that with two reactors, the lines a PRIVMSG queues are
+   * charged to it exactly once: what messagesOut adds up equals what lands
+   * in the members' queues, local or posted, and draining the inboxes
+   * counts nothing more. The reactors are never started; the bench thread
+   * plays each one in turn.
+   */
+  static bool checkOutCounts() {
+    Server server("0", "pw");
+    Reactor a(&server, 0), b(&server, 1);
+    Reactor *owners[2] = {&a, &b};
+    std::vector<Client *> members;
+    for (size_t i = 0; i < 6; ++i) {
+      Client *c = new Client(FIRST_FD + static_cast<int>(i));
+      c->setId(i + 1);
+      c->setOwner(owners[i % 2]);
+      c->setSendqLimit(1 << 20);
+      owners[i % 2]->_clients.set(c->getFd(), c);
+      server.registerClient(c);
+      members.push_back(c);
+    }
+    for (size_t i = 0; i < members.size(); ++i) {
+      Reactor::_current = owners[i % 2];
+      std::string nick = "user" + std::to_string(i);
+      server.handleCommand(members[i], "PASS pw");
+      server.handleCommand(members[i], "NICK " + nick);
+      server.handleCommand(members[i], "USER " + nick + " 0 * :Bench User");
+      server.handleCommand(members[i], "JOIN #x");
+    }
+    for (size_t k = 0; k < 2; ++k) {
+      Reactor::_current = owners[k];
+      owners[k]->drainInbox();
+    }
+    for (size_t i = 0; i < members.size(); ++i)
+      members[i]->clearOutputBuffer();
+
+    // user0 (on a) talks to the channel and to user1 (on b)
+    const Counter &out =
+        metrics().messagesOut[CommandTable::indexOf(*CommandTable::find("PRIVMSG"))];
+    uint64_t outBefore = out.value();
+    Reactor::_current = &a;
+    server.handleCommand(members[0], "PRIVMSG #x :hello everyone");
+    server.handleCommand(members[0], "PRIVMSG user1 :hello you");
+    uint64_t charged = out.value() - outBefore;
+
+    uint64_t queuedBefore = ServerMetrics::queuedLines;
+    Reactor::_current = &b;
+    b.drainInbox();
+    bool ok = ServerMetrics::queuedLines == queuedBefore;
+    Reactor::_current = NULL;
+
+    uint64_t delivered = 0;
+    struct iovec iov[16];
+    for (size_t i = 0; i < members.size(); ++i)
+      delivered += members[i]->fillIovec(iov, 16);
+    ok = ok && charged == members.size() && delivered == charged;
+
+    for (size_t i = 0; i < members.size(); ++i) {
+      members[i]->clearOutputBuffer();
+      owners[i % 2]->_clients.erase(members[i]->getFd());
+      delete members[i];
+    }
+    server._clients.clear(); // owned by us, not by a reactor
+    return ok;
+  }
+
+  /**
+   * @brief Checks that a channel emptied while a reactor may still be
+   * reading it without the lock leaves the index at once, but is only
+   * freed after that reactor's next quiescent state.
+   */
+  static bool checkDeferredFree() {
+    Server server("0", "pw");
+    Client member(FIRST_FD);
+    Rcu::Reader reader;
+    rcu().registerReader(reader);
+
+    Channel *gone = server.getOrCreateChannel("#gone");
+    gone->addClient(&member);
+    gone->removeClient(&member);
+    server.cleanupChannel("#gone");
+    bool ok = !server._channelIndex.find("#gone") &&
+              server._channelPool.inUse() == 1;
+
+    rcu().offline(reader);
+    Channel *next = server.getOrCreateChannel("#next");
+    next->addClient(&member); // any retire frees what became safe
+    ok = ok && server._channelPool.inUse() == 1 &&
+         *server._channelIndex.find("#next") == next;
+    next->removeClient(&member);
+    rcu().unregisterReader(reader);
+    return ok;
+  }
+};
+
+/**
+ * @brief handleCommand (parse, table lookup, lock, handler) for a few
+ * representative lines, from a member of a 10-user channel.
+ */
+static void benchDispatch() {
+  static const char *const CASES[][2] = {
+      {"dispatch/PING", "PING irc.example.net"},
+      {"dispatch/PRIVMSG-channel", "PRIVMSG #bench :hello everyone, how is it going?"},
+      {"dispatch/PRIVMSG-user", "PRIVMSG user1 :a direct message"},
+      {"dispatch/MODE-query", "MODE #bench"},
+      {"dispatch/unknown", "FOOBAR some parameters"},
+  };
+
+  std::ostringstream discard; // handlers log to stdout
+  std::streambuf *stdoutBuf = std::cout.rdbuf(discard.rdbuf());
+  {
+    ServerBench bench(10);
+    Client *sender = bench.clients[0];
+    for (size_t k = 0; k < sizeof(CASES) / sizeof(CASES[0]); ++k) {
+      if (!selected(CASES[k][0]))
+        continue;
+      std::string_view line(CASES[k][1]);
+      Meter meter;
+      for (size_t round = 0; round < 4000; ++round) {
+        meter.start();
+        for (size_t i = 0; i < 64; ++i)
+          bench.run(sender, line);
+        meter.stop(64);
+        bench.drain();
+      }
+      record(CASES[k][0], meter);
+    }
+  }
+  std::cout.rdbuf(stdoutBuf);
+}
+
+/* ============================= */
+/*         CHANNEL / OUTPUT      */
+/* ============================= */
+
+/**
+ * @brief One op is one shared line queued to every member but the sender.
+ * Queues are emptied (untimed) every 16 broadcasts.
+ */
+static void benchBroadcast(size_t members, size_t rounds) {
+  std::string name = "broadcast/" + std::to_string(members);
+  if (!selected(name))
+    return;
+
+  Channel channel("#bench");
+  std::vector<Client *> clients;
+  for (size_t i = 0; i < members; ++i) {
+    Client *c = new Client(FIRST_FD + static_cast<int>(i));
+    c->setNickname("user" + std::to_string(i));
+    channel.addClient(c);
+    clients.push_back(c);
+  }
+  SharedLine line = makeReply(MSG_PRIVMSG, "user0", "user0", "#bench",
+                              "a fairly ordinary chat line of about sixty bytes");
+
+  Meter meter;
+  for (size_t round = 0; round < rounds; ++round) {
+    meter.start();
+    for (size_t i = 0; i < 16; ++i)
+      channel.broadcast(line, clients[0]);
+    meter.stop(16);
+    for (size_t i = 0; i < clients.size(); ++i)
+      clients[i]->clearOutputBuffer();
+  }
+  record(name, meter);
+
+  for (size_t i = 0; i < clients.size(); ++i)
+    delete clients[i];
+}
+
+/**
+ * @brief One op is one consumeBytes() after a 1400-byte send, over a queue
+ * of 60-byte lines, so most calls pop lines and end mid-line.
+ */
+static void benchConsume() {
+  if (!selected("output/consumeBytes"))
+    return;
+  Client client(FIRST_FD);
+  SharedLine line = std::make_shared<const std::string>(std::string(58, 'x') + "\r\n");
+  const size_t LINES = 1024;
+  const size_t SEND = 1400;
+
+  Meter meter;
+  for (size_t round = 0; round < 2000; ++round) {
+    for (size_t i = 0; i < LINES; ++i)
+      client.queueMessage(line);
+    size_t calls = 0;
+    meter.start();
+    while (client.hasPendingSend()) {
+      client.consumeBytes(SEND);
+      ++calls;
+    }
+    meter.stop(calls);
+  }
+  record("output/consumeBytes", meter);
+}
+
+/* ============================= */
+/*             TIMERS            */
+/* ============================= */
+
+/**
+ * @brief A reactor's wheel with 100k client timers (1 s ticks, deadlines
+ * up to 3 minutes out).
+ *
+ * Steps:
+ *  - timers/reschedule-100k: one op re-arms a random pending timer
+ *  - timers/expire-100k: ticks through 10 minutes; one op is one timer
+ *    coming due (cascades included) and being re-armed 2 minutes later,
+ *    the way keepalive timers cycle
+ */
+static void benchTimers() {
+  const size_t TIMERS = 100000;
+  const uint64_t SEC = 1000000000ull;
+  if (!selected("timers/"))
+    return;
+
+  TimerWheel wheel(SEC, 0);
+  std::vector<TimerWheel::Timer> timers(TIMERS);
+  uint64_t seed = 12345;
+  for (size_t i = 0; i < TIMERS; ++i) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    wheel.schedule(timers[i], (1 + (seed >> 33) % 180) * SEC);
+  }
+
+  measure("timers/reschedule-100k", 2000000, [&](size_t i) {
+    size_t n = (i * 7919) % TIMERS;
+    wheel.schedule(timers[n], (1 + (i * 104729) % 180) * SEC);
+    return n;
+  });
+
+  if (!selected("timers/expire-100k"))
+    return;
+  Meter meter;
+  size_t fired = 0;
+  meter.start();
+  for (uint64_t second = 1; second <= 600; ++second) {
+    wheel.advance(second * SEC);
+    while (TimerWheel::Timer *t = wheel.nextExpired()) {
+      wheel.schedule(*t, (second + 120) * SEC);
+      ++fired;
+    }
+  }
+  meter.stop(fired);
+  record("timers/expire-100k", meter);
+}
+
+/* ============================= */
+/*        HELPERS / REPLIES      */
+/* ============================= */
+
+static void benchSplit() {
+  measure("split/commaList-1", 2000000, [](size_t) {
+    return splitCommaList("#general").size();
+  });
+  measure("split/commaList-5", 2000000, [](size_t) {
+    return splitCommaList("#general,#random,#dev,#ops,#offtopic").size();
+  });
+}
+
+static void benchReplies() {
+  const std::string nick = "somebody_long";
+  const std::string chan = "#performance-engineering";
+  const std::string topic =
+      "Reply formatting benchmark: a topic of a typical length for a channel";
+  const std::string text = "a fairly ordinary chat line of about sixty bytes";
+
+  measure("reply/401", 2000000, [&](size_t) {
+    return makeReply(ERR_NOSUCHNICK, nick)->size();
+  });
+  measure("reply/311", 2000000, [&](size_t) {
+    return makeReply(RPL_WHOISUSER, nick, "someuser", "localhost",
+                     "Some Real Name Of Moderate Length")
+        ->size();
+  });
+  measure("reply/332", 2000000, [&](size_t) {
+    return makeReply(RPL_TOPIC, nick, chan, topic)->size();
+  });
+  measure("reply/PRIVMSG", 2000000, [&](size_t) {
+    return makeReply(MSG_PRIVMSG, nick, nick, chan, text)->size();
+  });
+}
+
+/* ============================= */
+/*             OUTPUT            */
+/* ============================= */
+
+static void printText() {
+  std::printf("%-28s %12s %10s %10s %10s\n", "hotpath", "ops", "ns/op",
+              "allocs/op", "bytes/op");
+  for (size_t i = 0; i < g_rows.size(); ++i) {
+    const Meter &m = g_rows[i].meter;
+    std::printf("%-28s %12zu %10.1f %10.2f %10.1f\n", g_rows[i].name.c_str(),
+                m.ops(), m.nsPerOp(), m.allocsPerOp(), m.bytesPerOp());
+  }
+}
+
+static void printJson() {
+  std::printf("{\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < g_rows.size(); ++i) {
+    const Meter &m = g_rows[i].meter;
+    std::printf("    {\"name\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.2f, "
+                "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}%s\n",
+                g_rows[i].name.c_str(), m.ops(), m.nsPerOp(), m.allocsPerOp(),
+                m.bytesPerOp(), i + 1 < g_rows.size() ? "," : "");
+  }
+  std::printf("  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+  bool json = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--json")
+      json = true;
+    else if (arg.compare(0, 9, "--filter=") == 0)
+      g_filter = arg.substr(9);
+    else {
+      std::fprintf(stderr, "Usage: %s [--json] [--filter=SUBSTRING]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  std::ostringstream discard; // handlers log to stdout
+  std::streambuf *stdoutBuf = std::cout.rdbuf(discard.rdbuf());
+  bool countsOk = ServerBench::checkOutCounts();
+  bool freeOk = ServerBench::checkDeferredFree();
+  std::cout.rdbuf(stdoutBuf);
+  if (!countsOk) {
+    std::fprintf(stderr, "dispatch/out-counts: PRIVMSG lines charged != "
+                         "lines delivered across reactors\n");
+    return 1;
+  }
+  if (!freeOk) {
+    std::fprintf(stderr, "channel/deferred-free: channel freed under an "
+                         "online reader, or kept after it went offline\n");
+    return 1;
+  }
+
+  benchParse();
+  benchLines();
+  benchDispatch();
+  benchBroadcast(10, 100000);
+  benchBroadcast(1000, 2000);
+  benchBroadcast(10000, 200);
+  benchConsume();
+  benchSplit();
+  benchReplies();
+  benchTimers();
+
+  if (json)
+    printJson();
+  else
+    printText();
+  return 0;
+}
@@ -0,0 +1,711 @@
+/**
+ * @file ircbench.cpp
+ * @brief Load generator: N simulated clients driving a running ircserv.
+ *
+ * Steps:
+ *  - Open --clients connections over loopback, register them
+ *    (PASS/NICK/USER) and join each to --joins of --channels channels
+ *  - Issue PRIVMSG / PART+JOIN / MODE operations at --rate ops per second
+ *    for --duration seconds, picked by the --mix weights
+ *  - Every PRIVMSG carries a CLOCK_MONOTONIC timestamp; receivers record
+ *    now - timestamp in a log-linear histogram (end-to-end delivery latency)
+ *  - Report throughput and p50/p99/p999 latency, as text or --json
+ *  - --storm only connects and registers the clients, --window at a time,
+ *    and reports connections per second and connect-to-001 latency: a
+ *    reconnect storm against the accept path
+ *
+ * Single-threaded and event-driven (epoll, level-triggered). Run it on
+ * other cores than the server when comparing releases. Each simulated
+ * client sends far more than a person would, so start the server with
+ * --flood-rate=0 unless flood control itself is being measured.
+ * make bench-scaling runs one load against --threads=1, 2, 4 and 8.
+ *
+ * Usage: make ircbench && ./ircbench --port=6667 --password=pw
+ *          [--clients=N] [--channels=N] [--joins=N] [--rate=N]
+ *          [--duration=S] [--size=BYTES] [--mix=privmsg:90,joinpart:8,mode:2]
+ *          [--host=ADDR] [--json]
+ *        ./ircbench --storm --clients=10000 [--window=N] [--json]
+ */
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+/* ============================= */
+/*            OPTIONS            */
+/* ============================= */
+
+enum Op { OP_PRIVMSG, OP_JOINPART, OP_MODE, OP_COUNT };
+static const char *const OP_NAMES[OP_COUNT] = {"privmsg", "joinpart", "mode"};
+
+struct Options {
+  std::string host;
+  int port;
+  std::string password;
+  size_t clients;
+  size_t channels;
+  size_t joins;    // channels per client
+  double rate;     // operations per second, all clients together
+  double duration; // seconds of load after setup
+  size_t size;     // PRIVMSG text bytes (timestamp included)
+  unsigned mix[OP_COUNT];
+  bool json;
+  bool storm;    // connect and register only
+  size_t window; // handshakes in flight during setup
+
+  Options()
+      : host("127.0.0.1"), port(6667), password("pw"), clients(100),
+        channels(10), joins(1), rate(1000), duration(10), size(64), json(false),
+        storm(false), window(256) {
+    mix[OP_PRIVMSG] = 90;
+    mix[OP_JOINPART] = 8;
+    mix[OP_MODE] = 2;
+  }
+};
+
+static bool parseMix(const std::string &value, Options &opt) {
+  unsigned mix[OP_COUNT] = {0, 0, 0};
+  size_t start = 0;
+  while (start < value.size()) {
+    size_t end = value.find(',', start);
+    if (end == std::string::npos)
+      end = value.size();
+    std::string item = value.substr(start, end - start);
+    size_t colon = item.find(':');
+    if (colon == std::string::npos)
+      return false;
+    int op = -1;
+    for (int i = 0; i < OP_COUNT; ++i) {
+      if (item.compare(0, colon, OP_NAMES[i]) == 0)
+        op = i;
+    }
+    if (op < 0)
+      return false;
+    mix[op] = std::strtoul(item.c_str() + colon + 1, NULL, 10);
+    start = end + 1;
+  }
+  if (mix[OP_PRIVMSG] + mix[OP_JOINPART] + mix[OP_MODE] == 0)
+    return false;
+  std::memcpy(opt.mix, mix, sizeof(mix));
+  return true;
+}
+
+static bool parseOptions(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--json" || arg == "--storm") {
+      (arg == "--json" ? opt.json : opt.storm) = true;
+      continue;
+    }
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos)
+      return false;
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    const char *v = value.c_str();
+
+    if (name == "host")
+      opt.host = value;
+    else if (name == "port")
+      opt.port = std::atoi(v);
+    else if (name == "password")
+      opt.password = value;
+    else if (name == "clients")
+      opt.clients = std::strtoul(v, NULL, 10);
+    else if (name == "channels")
+      opt.channels = std::strtoul(v, NULL, 10);
+    else if (name == "joins")
+      opt.joins = std::strtoul(v, NULL, 10);
+    else if (name == "rate")
+      opt.rate = std::atof(v);
+    else if (name == "duration")
+      opt.duration = std::atof(v);
+    else if (name == "size")
+      opt.size = std::strtoul(v, NULL, 10);
+    else if (name == "window")
+      opt.window = std::strtoul(v, NULL, 10);
+    else if (name == "mix") {
+      if (!parseMix(value, opt))
+        return false;
+    } else
+      return false;
+  }
+  return opt.port > 0 && opt.clients > 0 && opt.channels > 0 &&
+         opt.joins > 0 && opt.joins <= opt.channels && opt.rate > 0 &&
+         opt.duration > 0 && opt.window > 0;
+}
+
+/* ============================= */
+/*            CLOCK              */
+/* ============================= */
+
+static uint64_t nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+/* ============================= */
+/*           HISTOGRAM           */
+/* ============================= */
+
+/**
+ * @brief Log-linear latency histogram: 16 linear sub-buckets per power of
+ * two (about 6% resolution), exact below 32 ns. Fixed size, no allocation
+ * per sample.
+ */
+class Histogram {
+public:
+  static const int SUB = 16;
+  static const int BUCKETS = 64 * SUB;
+
+  Histogram() : _counts(BUCKETS, 0), _total(0), _sum(0), _max(0) {}
+
+  void record(uint64_t ns) {
+    ++_counts[index(ns)];
+    ++_total;
+    _sum += ns;
+    if (ns > _max)
+      _max = ns;
+  }
+
+  uint64_t total() const { return _total; }
+  uint64_t max() const { return _max; }
+  double mean() const { return _total ? double(_sum) / _total : 0; }
+
+  /* Midpoint of the bucket holding the q-quantile sample */
+  uint64_t percentile(double q) const {
+    if (_total == 0)
+      return 0;
+    uint64_t rank = static_cast<uint64_t>(q * _total);
+    if (rank >= _total)
+      rank = _total - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+      seen += _counts[i];
+      if (seen > rank)
+        return (lowerBound(i) + lowerBound(i + 1)) / 2;
+    }
+    return _max;
+  }
+
+private:
+  std::vector<uint64_t> _counts;
+  uint64_t _total;
+  uint64_t _sum;
+  uint64_t _max;
+
+  static int index(uint64_t v) {
+    if (v < 2 * SUB)
+      return static_cast<int>(v);
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - 4; // keeps the top 5 bits: 16..31
+    return (shift + 1) * SUB + static_cast<int>((v >> shift) & (SUB - 1));
+  }
+
+  static uint64_t lowerBound(int i) {
+    if (i < 2 * SUB)
+      return i;
+    int shift = i / SUB - 1;
+    return static_cast<uint64_t>(SUB + i % SUB) << shift;
+  }
+};
+
+/* ============================= */
+/*          CONNECTIONS          */
+/* ============================= */
+
+struct Conn {
+  int fd;
+  std::string nick;
+  std::vector<size_t> channels;
+  std::string in;
+  std::string out;
+  bool writable; // EPOLLOUT armed
+  bool registered;
+  size_t joined; // 366 replies seen during setup
+  bool open;
+  uint64_t openedAt; // connect() time, for --storm
+
+  Conn()
+      : fd(-1), writable(false), registered(false), joined(0), open(false),
+        openedAt(0) {}
+};
+
+struct Stats {
+  uint64_t sent[OP_COUNT];
+  uint64_t delivered;
+  uint64_t errors; // 4xx/5xx numerics
+  uint64_t disconnects;
+  Histogram latency;
+
+  Stats() : delivered(0), errors(0), disconnects(0) {
+    std::memset(sent, 0, sizeof(sent));
+  }
+};
+
+/**
+ * @brief Owns the epoll instance and every simulated client.
+ */
+class LoadGenerator {
+public:
+  explicit LoadGenerator(const Options &opt)
+      : _opt(opt), _epoll(epoll_create1(0)), _conns(opt.clients),
+        _measuring(false), _seed(0x9E3779B97F4A7C15ull) {}
+
+  ~LoadGenerator() {
+    for (size_t i = 0; i < _conns.size(); ++i) {
+      if (_conns[i].fd >= 0)
+        close(_conns[i].fd);
+    }
+    if (_epoll >= 0)
+      close(_epoll);
+  }
+
+  bool setup(double &seconds, size_t &ready);
+  void run(double &seconds);
+  const Stats &stats() const { return _stats; }
+
+private:
+  const Options &_opt;
+  int _epoll;
+  std::vector<Conn> _conns;
+  bool _measuring; // latency samples only count during the run phase
+  uint64_t _seed;
+  Stats _stats;
+
+  uint64_t random() {
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 7;
+    _seed ^= _seed << 17;
+    return _seed;
+  }
+
+  static std::string channelName(size_t n) {
+    return "#bench" + std::to_string(n);
+  }
+
+  bool connectOne(size_t i);
+  void send(Conn &c, const std::string &data);
+  void flush(Conn &c);
+  void drop(Conn &c);
+  void poll(int timeoutMs);
+  void readFrom(Conn &c);
+  void handleLine(Conn &c, const char *line, size_t length);
+  void issue(Op op);
+};
+
+bool LoadGenerator::connectOne(size_t i) {
+  Conn &c = _conns[i];
+  c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (c.fd < 0)
+    return false;
+  int yes = 1;
+  setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(_opt.port);
+  inet_pton(AF_INET, _opt.host.c_str(), &addr.sin_addr);
+  if (connect(c.fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 &&
+      errno != EINPROGRESS) {
+    close(c.fd);
+    c.fd = -1;
+    return false;
+  }
+
+  epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.u64 = i;
+  epoll_ctl(_epoll, EPOLL_CTL_ADD, c.fd, &ev);
+  c.open = true;
+  c.openedAt = nowNs();
+
+  c.nick = "b" + std::to_string(i);
+  for (size_t j = 0; j < _opt.joins && !_opt.storm; ++j)
+    c.channels.push_back((i * _opt.joins + j) % _opt.channels);
+
+  std::string hello = "PASS " + _opt.password + "\r\nNICK " + c.nick +
+                      "\r\nUSER bench 0 * :ircbench\r\n";
+  for (size_t j = 0; j < c.channels.size(); ++j)
+    hello += "JOIN " + channelName(c.channels[j]) + "\r\n";
+  send(c, hello);
+  return true;
+}
+
+void LoadGenerator::send(Conn &c, const std::string &data) {
+  if (!c.open)
+    return;
+  c.out += data;
+  flush(c);
+}
+
+void LoadGenerator::flush(Conn &c) {
+  while (!c.out.empty()) {
+    ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+    if (n > 0) {
+      c.out.erase(0, n);
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == ENOTCONN))
+      break; // connect still in progress or socket full
+    drop(c);
+    return;
+  }
+  bool want = !c.out.empty();
+  if (want != c.writable) {
+    epoll_event ev;
+    ev.events = want ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.u64 = &c - &_conns[0];
+    epoll_ctl(_epoll, EPOLL_CTL_MOD, c.fd, &ev);
+    c.writable = want;
+  }
+}
+
+void LoadGenerator::drop(Conn &c) {
+  if (!c.open)
+    return;
+  c.open = false;
+  epoll_ctl(_epoll, EPOLL_CTL_DEL, c.fd, NULL);
+  close(c.fd);
+  c.fd = -1;
+  ++_stats.disconnects;
+}
+
+/**
+ * @brief Parses one line from the server.
+ *
+ * Counts registration (001), joins (366), error numerics (4xx/5xx) and
+ * PRIVMSG deliveries, whose "ts=" field gives the delivery latency.
+ */
+void LoadGenerator::handleLine(Conn &c, const char *line, size_t length) {
+  std::string_view text(line, length);
+  size_t sp = text.find(' ');
+  if (sp == std::string_view::npos)
+    return;
+  std::string_view verb = text.substr(sp + 1, 7);
+
+  if (verb.compare(0, 7, "PRIVMSG") == 0) {
+    size_t ts = text.find(" :ts=");
+    if (ts == std::string_view::npos)
+      return;
+    uint64_t sentAt = std::strtoull(line + ts + 5, NULL, 10);
+    ++_stats.delivered;
+    if (_measuring)
+      _stats.latency.record(nowNs() - sentAt);
+    return;
+  }
+  if (verb.size() >= 3 && verb[0] >= '0' && verb[0] <= '9') {
+    if (verb.compare(0, 3, "001") == 0) {
+      c.registered = true;
+      if (_opt.storm)
+        _stats.latency.record(nowNs() - c.openedAt);
+    }
+    else if (verb.compare(0, 3, "366") == 0)
+      ++c.joined;
+    else if (verb[0] == '4' || verb[0] == '5')
+      ++_stats.errors;
+  }
+}
+
+void LoadGenerator::readFrom(Conn &c) {
+  char buf[16384];
+  for (;;) {
+    ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+      c.in.append(buf, n);
+      if (static_cast<size_t>(n) < sizeof(buf))
+        break;
+      continue;
+    }
+    if (n < 0 && errno == EAGAIN)
+      break;
+    drop(c);
+    return;
+  }
+
+  size_t start = 0;
+  for (;;) {
+    size_t nl = c.in.find('\n', start);
+    if (nl == std::string::npos)
+      break;
+    size_t end = nl > start && c.in[nl - 1] == '\r' ? nl - 1 : nl;
+    handleLine(c, c.in.data() + start, end - start);
+    start = nl + 1;
+  }
+  c.in.erase(0, start);
+}
+
+void LoadGenerator::poll(int timeoutMs) {
+  epoll_event events[256];
+  int n = epoll_wait(_epoll, events, 256, timeoutMs);
+  for (int i = 0; i < n; ++i) {
+    Conn &c = _conns[events[i].data.u64];
+    if (!c.open)
+      continue;
+    if (events[i].events & EPOLLOUT)
+      flush(c);
+    if (c.open && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+      readFrom(c);
+  }
+}
+
+/**
+ * @brief Opens every connection, keeping at most --window handshakes in
+ * flight (256 by default, so the listen backlog does not overflow), and
+ * waits until each client is registered and has joined its channels
+ * (30 s at most).
+ */
+bool LoadGenerator::setup(double &seconds, size_t &ready) {
+  if (_epoll < 0)
+    return false;
+  uint64_t start = nowNs();
+  uint64_t deadline = start + 30000000000ull;
+  size_t opened = 0;
+
+  for (;;) {
+    ready = 0;
+    for (size_t i = 0; i < opened; ++i) {
+      if (_conns[i].open && _conns[i].registered &&
+          _conns[i].joined >= _conns[i].channels.size())
+        ++ready;
+    }
+    while (opened < _conns.size() && opened - ready < _opt.window) {
+      if (!connectOne(opened))
+        return false;
+      ++opened;
+    }
+    if (ready == _conns.size() || nowNs() > deadline)
+      break;
+    poll(10);
+  }
+  seconds = (nowNs() - start) / 1e9;
+  return ready > 0;
+}
+
+/**
+ * @brief Sends one operation from a random connected client.
+ */
+void LoadGenerator::issue(Op op) {
+  Conn &c = _conns[random() % _conns.size()];
+  if (!c.open)
+    return;
+  std::string chan = channelName(c.channels[random() % c.channels.size()]);
+
+  switch (op) {
+  case OP_PRIVMSG: {
+    std::string msg = "PRIVMSG " + chan + " :ts=" + std::to_string(nowNs());
+    size_t header = msg.size() - chan.size() - 10; // text after " :"
+    if (header < _opt.size) {
+      msg += ' ';
+      msg.append(_opt.size - header - 1, 'x');
+    }
+    send(c, msg + "\r\n");
+    break;
+  }
+  case OP_JOINPART:
+    send(c, "PART " + chan + "\r\nJOIN " + chan + "\r\n");
+    break;
+  case OP_MODE:
+    send(c, "MODE " + chan + "\r\n");
+    break;
+  default:
+    return;
+  }
+  ++_stats.sent[op];
+}
+
+/**
+ * @brief Issues operations at the target rate for the configured duration,
+ * then drains deliveries still in flight for up to two seconds.
+ */
+void LoadGenerator::run(double &seconds) {
+  unsigned weight = _opt.mix[OP_PRIVMSG] + _opt.mix[OP_JOINPART] +
+                    _opt.mix[OP_MODE];
+  _measuring = true;
+  uint64_t start = nowNs();
+  uint64_t end = start + static_cast<uint64_t>(_opt.duration * 1e9);
+  uint64_t issued = 0;
+
+  for (uint64_t now = start; now < end; now = nowNs()) {
+    uint64_t due = static_cast<uint64_t>((now - start) / 1e9 * _opt.rate);
+    while (issued < due) {
+      unsigned pick = random() % weight;
+      Op op = OP_PRIVMSG;
+      if (pick >= _opt.mix[OP_PRIVMSG])
+        op = pick < _opt.mix[OP_PRIVMSG] + _opt.mix[OP_JOINPART] ? OP_JOINPART
+                                                                 : OP_MODE;
+      issue(op);
+      ++issued;
+    }
+    poll(1);
+  }
+  seconds = (nowNs() - start) / 1e9;
+
+  uint64_t drainEnd = nowNs() + 2000000000ull;
+  uint64_t lastDelivered = ~0ull;
+  while (nowNs() < drainEnd && lastDelivered != _stats.delivered) {
+    lastDelivered = _stats.delivered;
+    poll(200);
+  }
+}
+
+/* ============================= */
+/*            REPORT             */
+/* ============================= */
+
+static std::string formatNs(uint64_t ns) {
+  char buf[32];
+  if (ns < 10000)
+    std::snprintf(buf, sizeof(buf), "%llu ns", (unsigned long long)ns);
+  else if (ns < 10000000)
+    std::snprintf(buf, sizeof(buf), "%.1f us", ns / 1e3);
+  else
+    std::snprintf(buf, sizeof(buf), "%.1f ms", ns / 1e6);
+  return buf;
+}
+
+static void reportText(const Options &opt, const Stats &s, double setup,
+                       size_t ready, double elapsed) {
+  uint64_t ops = s.sent[OP_PRIVMSG] + s.sent[OP_JOINPART] + s.sent[OP_MODE];
+  const Histogram &h = s.latency;
+  std::printf("ircbench: %zu clients, %zu channels, %zu joins/client, "
+              "rate %.0f/s, %.0f s\n",
+              opt.clients, opt.channels, opt.joins, opt.rate, opt.duration);
+  std::printf("setup:      %zu/%zu ready in %.2f s\n", ready, opt.clients,
+              setup);
+  std::printf("sent:       %llu ops (privmsg %llu, joinpart %llu, mode %llu)"
+              "  %.1f ops/s\n",
+              (unsigned long long)ops, (unsigned long long)s.sent[OP_PRIVMSG],
+              (unsigned long long)s.sent[OP_JOINPART],
+              (unsigned long long)s.sent[OP_MODE], ops / elapsed);
+  std::printf("delivered:  %llu lines  %.1f lines/s\n",
+              (unsigned long long)s.delivered, s.delivered / elapsed);
+  std::printf("errors:     %llu error numerics, %llu disconnects\n",
+              (unsigned long long)s.errors, (unsigned long long)s.disconnects);
+  std::printf("latency:    p50 %s  p99 %s  p999 %s  max %s  mean %s"
+              "  (%llu samples)\n",
+              formatNs(h.percentile(0.50)).c_str(),
+              formatNs(h.percentile(0.99)).c_str(),
+              formatNs(h.percentile(0.999)).c_str(), formatNs(h.max()).c_str(),
+              formatNs(static_cast<uint64_t>(h.mean())).c_str(),
+              (unsigned long long)h.total());
+}
+
+/* --storm: how fast the server took the connections */
+static void reportStorm(const Options &opt, const Stats &s, double setup,
+                        size_t ready) {
+  const Histogram &h = s.latency;
+  if (opt.json) {
+    std::printf("{\"clients\": %zu, \"window\": %zu, \"ready\": %zu, "
+                "\"setup_s\": %.3f, \"connections_per_s\": %.1f, "
+                "\"disconnects\": %llu, \"register_ns\": {\"p50\": %llu, "
+                "\"p99\": %llu, \"max\": %llu}}\n",
+                opt.clients, opt.window, ready, setup, ready / setup,
+                (unsigned long long)s.disconnects,
+                (unsigned long long)h.percentile(0.50),
+                (unsigned long long)h.percentile(0.99),
+                (unsigned long long)h.max());
+    return;
+  }
+  std::printf("ircbench storm: %zu clients, %zu in flight\n", opt.clients,
+              opt.window);
+  std::printf("registered: %zu/%zu in %.2f s  %.1f connections/s\n", ready,
+              opt.clients, setup, ready / setup);
+  std::printf("connect->001: p50 %s  p99 %s  max %s  (%llu disconnects)\n",
+              formatNs(h.percentile(0.50)).c_str(),
+              formatNs(h.percentile(0.99)).c_str(), formatNs(h.max()).c_str(),
+              (unsigned long long)s.disconnects);
+}
+
+static void reportJson(const Options &opt, const Stats &s, double setup,
+                       size_t ready, double elapsed) {
+  uint64_t ops = s.sent[OP_PRIVMSG] + s.sent[OP_JOINPART] + s.sent[OP_MODE];
+  const Histogram &h = s.latency;
+  std::printf("{\"clients\": %zu, \"channels\": %zu, \"joins\": %zu, "
+              "\"rate\": %.0f, \"duration_s\": %.3f, \"setup_s\": %.3f, "
+              "\"ready\": %zu, ",
+              opt.clients, opt.channels, opt.joins, opt.rate, elapsed, setup,
+              ready);
+  std::printf("\"sent\": {\"privmsg\": %llu, \"joinpart\": %llu, "
+              "\"mode\": %llu}, \"ops_per_s\": %.1f, ",
+              (unsigned long long)s.sent[OP_PRIVMSG],
+              (unsigned long long)s.sent[OP_JOINPART],
+              (unsigned long long)s.sent[OP_MODE], ops / elapsed);
+  std::printf("\"delivered\": %llu, \"delivered_per_s\": %.1f, "
+              "\"errors\": %llu, \"disconnects\": %llu, ",
+              (unsigned long long)s.delivered, s.delivered / elapsed,
+              (unsigned long long)s.errors, (unsigned long long)s.disconnects);
+  std::printf("\"latency_ns\": {\"samples\": %llu, \"p50\": %llu, "
+              "\"p99\": %llu, \"p999\": %llu, \"max\": %llu, "
+              "\"mean\": %.0f}}\n",
+              (unsigned long long)h.total(),
+              (unsigned long long)h.percentile(0.50),
+              (unsigned long long)h.percentile(0.99),
+              (unsigned long long)h.percentile(0.999),
+              (unsigned long long)h.max(), h.mean());
+}
+
+/* ============================= */
+/*             MAIN              */
+/* ============================= */
+
+/* Lifts the soft descriptor limit to the hard one for large --clients */
+static void raiseFdLimit() {
+  rlimit lim;
+  if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+  }
+}
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseOptions(argc, argv, opt)) {
+    std::fprintf(stderr,
+                 "Usage: %s [--host=ADDR] [--port=N] [--password=PW]"
+                 " [--clients=N] [--channels=N] [--joins=N] [--rate=OPS]"
+                 " [--duration=S] [--size=BYTES]"
+                 " [--mix=privmsg:W,joinpart:W,mode:W] [--storm]"
+                 " [--window=N] [--json]\n",
+                 argv[0]);
+    return 1;
+  }
+  raiseFdLimit();
+
+  LoadGenerator gen(opt);
+  double setup = 0;
+  size_t ready = 0;
+  if (!gen.setup(setup, ready)) {
+    std::fprintf(stderr, "ircbench: could not connect to %s:%d\n",
+                 opt.host.c_str(), opt.port);
+    return 1;
+  }
+  if (opt.storm) {
+    reportStorm(opt, gen.stats(), setup, ready);
+    return 0;
+  }
+
+  double elapsed = 0;
+  gen.run(elapsed);
+  if (opt.json)
+    reportJson(opt, gen.stats(), setup, ready, elapsed);
+  else
+    reportText(opt, gen.stats(), setup, ready, elapsed);
+  return 0;
+}
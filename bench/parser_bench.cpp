@@ -0,0 +1,99 @@
+/**
+ * @file parser_bench.cpp
+ * @brief Compares Parser::parse with the istringstream parser it replaced.
+ *
+ * Usage: make bench (builds with -O2 and runs every benchmark)
+ */
+
+#include "../includes/Parser.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* ============================= */
+/*     PREVIOUS IMPLEMENTATION   */
+/* ============================= */
+
+struct LegacyCommand {
+  std::string command;
+  std::vector<std::string> params;
+  std::string trailing;
+};
+
+static LegacyCommand legacyParse(const std::string &line) {
+  LegacyCommand result;
+  std::istringstream iss(line);
+  std::string token;
+  bool trailingFound = false;
+
+  while (iss >> token) {
+    if (!trailingFound && token.size() > 0 && token[0] == ':') {
+      trailingFound = true;
+      result.trailing = token.substr(1);
+
+      std::string rest;
+      std::getline(iss, rest);
+      if (!rest.empty() && rest[0] == ' ')
+        rest.erase(0, 1);
+      result.trailing += (rest.empty() ? "" : " " + rest);
+    } else if (result.command.empty()) {
+      result.command = token;
+    } else if (!trailingFound) {
+      result.params.push_back(token);
+    }
+  }
+  return result;
+}
+
+/* ============================= */
+/*             RUNNER            */
+/* ============================= */
+
+static const char *CORPUS[] = {
+    "PRIVMSG #general :hello everyone, how is it going today?",
+    "PRIVMSG alice :a direct message with a few more words in it",
+    "PING irc.example.net",
+    "JOIN #general,#random key1,key2",
+    "MODE #general +o bob",
+    ":nick!user@host PRIVMSG #chan :prefixed message from a relay",
+    "@time=2024-01-01T00:00:00.000Z;msgid=abc PRIVMSG #c :tagged",
+    "USER guest 0 * :Real Name Here",
+};
+static const size_t CORPUS_SIZE = sizeof(CORPUS) / sizeof(CORPUS[0]);
+static const size_t ITERATIONS = 2000000;
+
+static volatile size_t g_sink; // keeps the optimizer from dropping the work
+
+template <typename Fn> static double nsPerLine(const Fn &parseOne) {
+  std::vector<std::string> lines(CORPUS, CORPUS + CORPUS_SIZE);
+  size_t sink = 0;
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ITERATIONS; ++i)
+    sink += parseOne(lines[i % CORPUS_SIZE]);
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  g_sink = sink;
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         ITERATIONS;
+}
+
+int main() {
+  double legacy = nsPerLine([](const std::string &line) {
+    LegacyCommand cmd = legacyParse(line);
+    return cmd.command.size() + cmd.params.size() + cmd.trailing.size();
+  });
+  double current = nsPerLine([](const std::string &line) {
+    ParsedCommand cmd = Parser::parse(line);
+    return cmd.command.size() + cmd.params.size() + cmd.trailing.size();
+  });
+
+  std::printf("parser/istringstream  %8.1f ns/line\n", legacy);
+  std::printf("parser/string_view    %8.1f ns/line\n", current);
+  std::printf("parser/speedup        %8.1fx\n", legacy / current);
+  return 0;
+}
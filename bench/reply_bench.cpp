@@ -0,0 +1,130 @@
+/**
+ * @file reply_bench.cpp
+ * @brief Compares makeReply() with the string-concatenation macros it
+ * replaced, including the copy sendReply() made into a shared line.
+ *
+ * Usage: make bench (builds with -O2 and runs every benchmark)
+ */
+
+#include "../includes/Replies.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+/* ============================= */
+/*       ALLOCATION COUNTING     */
+/* ============================= */
+
+static size_t g_allocs;
+
+void *operator new(size_t size) {
+  ++g_allocs;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+/* ============================= */
+/*     PREVIOUS IMPLEMENTATION   */
+/* ============================= */
+
+#define LEGACY_ERR_NOSUCHNICK(nick)                                            \
+  (std::string(":ircserver 401 * ") + (nick) + " :No such nick\r\n")
+
+#define LEGACY_RPL_WHOISUSER(nick, user, host, real)                           \
+  (std::string(":ircserver 311 ") + (nick) + " " + (user) + " " + (host) +     \
+   " * :" + (real) + "\r\n")
+
+#define LEGACY_RPL_TOPIC(nick, chan, topic)                                    \
+  (std::string(":ircserver 332 ") + (nick) + " " + (chan) + " :" + (topic) +   \
+   "\r\n")
+
+/* sendReply() copied every reply into the client's queue */
+static SharedLine legacyQueue(const std::string &msg) {
+  return std::make_shared<const std::string>(msg);
+}
+
+/* ============================= */
+/*            HARNESS            */
+/* ============================= */
+
+static const size_t ITERATIONS = 2000000;
+static volatile size_t g_sink; // keeps the optimizer from dropping the work
+
+struct Result {
+  double ns;
+  double allocs;
+};
+
+template <typename Fn> static Result measure(const Fn &buildOne) {
+  size_t sink = 0;
+  size_t allocsBefore = g_allocs;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ITERATIONS; ++i)
+    sink += buildOne()->size();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  g_sink = sink;
+  Result r;
+  r.ns = std::chrono::duration<double, std::nano>(end - start).count() /
+         ITERATIONS;
+  r.allocs = static_cast<double>(g_allocs - allocsBefore) / ITERATIONS;
+  return r;
+}
+
+static void report(const char *name, const Result &legacy,
+                   const Result &current) {
+  std::printf("reply/%-10s macros %6.1f ns %4.1f allocs | template %6.1f ns "
+              "%4.1f allocs | %4.1fx\n",
+              name, legacy.ns, legacy.allocs, current.ns, current.allocs,
+              legacy.ns / current.ns);
+}
+
+int main() {
+  const std::string nick = "somebody_long";
+  const std::string user = "someuser";
+  const std::string real = "Some Real Name Of Moderate Length";
+  const std::string chan = "#performance-engineering";
+  const std::string topic =
+      "Reply formatting benchmark: a topic of a typical length for a channel";
+  const std::string text = "a fairly ordinary chat line of about sixty bytes";
+
+  report("401",
+         measure([&] { return legacyQueue(LEGACY_ERR_NOSUCHNICK(nick)); }),
+         measure([&] { return makeReply(ERR_NOSUCHNICK, nick); }));
+
+  report("311",
+         measure([&] {
+           return legacyQueue(
+               LEGACY_RPL_WHOISUSER(nick, user, "localhost", real));
+         }),
+         measure([&] {
+           return makeReply(RPL_WHOISUSER, nick, user, "localhost", real);
+         }));
+
+  report("332",
+         measure([&] { return legacyQueue(LEGACY_RPL_TOPIC(nick, chan, topic)); }),
+         measure([&] { return makeReply(RPL_TOPIC, nick, chan, topic); }));
+
+  // handlePRIVMSG built relayed lines the same way, then broadcast() copied
+  // them into a shared line
+  report("PRIVMSG",
+         measure([&] {
+           std::string msg = ":" + nick + "!" + user + "@localhost PRIVMSG " +
+                             chan + " :";
+           msg.append(text).append("\r\n");
+           return legacyQueue(msg);
+         }),
+         measure([&] {
+           return makeReply(MSG_PRIVMSG, nick, user, chan, text);
+         }));
+  return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef CASEMAP_HPP
+#define CASEMAP_HPP
+
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Casemapping advertised in RPL_ISUPPORT (CASEMAPPING=rfc1459).
+ *
+ * Under rfc1459, A-Z fold to a-z and the Scandinavian characters [\]^
+ * fold to {|}~, so "Nick[1]" and "nick{1}" are the same nickname.
+ */
+#define SERVER_CASEMAPPING "rfc1459"
+
+/* Longest nickname accepted by NICK, advertised as NICKLEN */
+#define SERVER_NICKLEN 30
+
+inline char ircToLower(char c) {
+  if (c >= 'A' && c <= '^')
+    return static_cast<char>(c + ('a' - 'A'));
+  return c;
+}
+
+/**
+ * @brief Returns the rfc1459-casefolded form of name, used as the key of
+ * case-insensitive indexes.
+ */
+inline std::string ircCasefold(std::string_view name) {
+  std::string folded(name);
+  for (size_t i = 0; i < folded.size(); ++i)
+    folded[i] = ircToLower(folded[i]);
+  return folded;
+}
+
+#endif
@@ -13,17 +13,25 @@
 #ifndef CHANNEL_HPP
 #define CHANNEL_HPP
 
+#include "Client.hpp"
+#include "MemberTable.hpp"
+#include "NamesCache.hpp"
+
+#include <atomic>
 #include <string>
 #include <vector>
 
-class Client;
-
 /**
  * @brief Represents an IRC channel and its member list.
  *
  * Steps:
  *  - Store channel name
- *  - Track clients inside the channel
+ *  - Track clients inside the channel (MemberTable: one record per client
+ *    carrying its operator/voice/invited bits)
+ *  - Publish the member list as an immutable view for lock-free readers
+ *    (PRIVMSG): replaced on every join and leave, the old one retired
+ *    through rcu()
+ *  - Keep the NAMES reply pre-chunked, updated on every member change
  *  - Provide join/leave operations
  *  - Manage channel modes (topic protection, invite-only, key, limit)
  *  - Track channel operators and invited users
@@ -37,7 +45,6 @@ public:
   // getters
   const std::string &getName() const;
   const std::vector<Client *> &getClients() const;
-  const std::vector<Client *> &getOperators() const;
   int getLimit() const;
   bool isTopicProtected() const;
   bool isInviteOnly() const;
@@ -63,14 +70,17 @@ public:
 
   void addClient(Client *client);
   bool hasClient(Client *client) const;
+  bool hasMember(Client *client) const;
   void removeClient(Client *client);
-  void inviteNickname(const std::string &nickname);
-  bool isInvited(const std::string &nickname) const;
-  void removeInvited(const std::string &nickname);
-  void addOperator(Client *client);
+  void inviteClient(Client *client);
+  bool isInvited(Client *client) const;
+  void removeInvited(Client *client);
+  bool addOperator(Client *client);
   void removeOperator(Client *client);
   bool isOperator(Client *client) const;
   void clearInvites();
+  void renameMember(Client *client, const std::string &oldNick);
+  void collectNames(std::vector<SharedLine> &lines);
 
 
   /* ============================= */
@@ -78,17 +88,28 @@ public:
   /* ============================= */
 
   void broadcast(const std::string &msg, Client *exclude = NULL);
+  void broadcast(const SharedLine &line, Client *exclude = NULL);
 
 private:
+  // Members sorted by Client address, each with its delivery route
+  struct MemberView {
+    std::vector<Route> routes;
+  };
+
   std::string _name;
-  std::vector<Client *> _clients;
-  std::vector<Client *> _operators;
-  std::vector<std::string> _invited;
+  MemberTable _members;
+  std::atomic<const MemberView *> _view; // read without the state lock
+  NamesCache _names;
   bool _topicProtected;
   std::string _key;
   bool _inviteOnly;
   int _limit;
   std::string _topic;
+
+  void publishView(MemberView *next);
+
+  Channel(const Channel &);
+  Channel &operator=(const Channel &);
 };
 
 #endif
@@ -13,11 +13,36 @@
 #ifndef CLIENT_HPP
 #define CLIENT_HPP
 
+#include "InputBuffer.hpp"
+#include "SharedLine.hpp"
+#include "TimerWheel.hpp"
+
+#include <atomic>
 #include <string>
 #include <vector>
 #include <deque>
+#include <stdint.h>
+#include <sys/uio.h>
 
 class Channel; // forward declaration
+class Reactor;
+class Client;
+
+/**
+ * @brief Where a client's output goes, copied out of the Client.
+ *
+ * Lock-free readers (see Rcu) hold Routes, not Clients: only the owning
+ * reactor may dereference client, since it is the one that frees it.
+ * Everyone else posts by fd and id, which the owner checks on delivery.
+ */
+struct Route {
+  Client *client;
+  Reactor *owner; // NULL for clients without a reactor (bench/)
+  int fd;
+  unsigned long clientId;
+
+  void deliver(const SharedLine &line) const;
+};
 
 class Client {
 public:
@@ -27,15 +52,27 @@ public:
 
   // Getters
   int getFd() const;
+  unsigned long getId() const;
+  Reactor *getOwner() const;
   const std::string &getNickname() const;
   const std::string &getUsername() const;
   const std::string &getRealname() const;
-  const std::string &getBuffer() const;
-  std::string &getBufferRef();
+  InputBuffer &getInput();
   bool isAuthenticated() const;
   bool hasValidPass() const;
-  std::deque<std::string> getoutputBuffer() const;
-  int getOutputBufferSize() const;
+  bool isOper() const;
+  const OutputQueue &getoutputBuffer() const;
+  size_t getOutputBufferSize() const;
+  size_t getSendqLimit() const;
+  size_t getSendqPeak() const;
+  bool isSendqExceeded() const;
+  uint64_t getFloodClock() const;
+  bool isThrottled() const;
+  bool isReadPending() const;
+  TimerWheel::Timer &getTimer();
+  uint64_t getLastActivity() const;
+  bool isAwaitingPong() const;
+  Route getRoute();
 
   // Setters
   void setNickname(const std::string &nick);
@@ -43,34 +80,57 @@ public:
   void setRealname(const std::string &real);
   void setAuthenticated(bool status);
   void setValidPass(bool status);
-  
-  // Buffer handling
-  void appendToBuffer(const std::string &data);
-  void clearBuffer();
-  
+  void setOper(bool status);
+  void setId(unsigned long id);
+  void setOwner(Reactor *owner);
+  void setFloodClock(uint64_t ns);
+  void setThrottled(bool status);
+  void setReadPending(bool status);
+  void setLastActivity(uint64_t ns);
+  void setAwaitingPong(bool status);
+  void setSendqLimit(size_t bytes);
+  void setSendqExceeded(bool status);
+
   // outputBuffer handling
   /**
    * @brief Manages the output buffer for sending data to the client.
    * - queueMessage(data): adds data to output buffer and updates size
+   * - queueMessage(line): same for an already shared line (broadcasts);
+   *   only the reference is queued, the bytes are not copied
    * - hasPendingSend(): checks if there is data to send
    * 
-   * - peekOutputBuffer(): peeks at next message without removing
-   * - consumeBytes(n): removes n bytes from front of buffer and updates size
+   * - fillIovec(iov, max): points iovecs at the unsent bytes of up to max
+   *   queued lines, without copying them
+   * - consumeBytes(n): advances the front offset by n bytes, dropping lines
+   *   that are fully sent, and updates size
    * - getOutputBufferSize(): gets total size of output buffer
    * 
    * - clearOutputBuffer(): clears all queued messages
    * 
+   *  queueMessage() may be called from any reactor thread; output for a
+   *  client owned by another reactor is posted to that reactor's inbox.
+   *  Each line is counted once in ServerMetrics::queuedLines where it is
+   *  produced; enqueue() is the owner-side append that does not count.
+   *  A line that would take the queue past its limit (--sendq, or
+   *  --sendq-unregistered before registration) or past the owner's share
+   *  of --sendq-total is not queued, and the client is disconnected with
+   *  "SendQ exceeded" (see Reactor::exceedSendq).
+   *
    *  how to use in server:
    *  - while client->hasPendingSend():
-   *   - send(client->peekOutputBuffer())
-   *   - client->consumeBytes(bytes_sent)
+   *   - n = client->fillIovec(iov, IOV_MAX)
+   *   - sent = writev / sendmsg over those n iovecs
+   *   - client->consumeBytes(sent)
    */
 
   void queueMessage(const std::string &data);
+  void queueMessage(const SharedLine &line);
+  void enqueue(const SharedLine &line);
   bool hasPendingSend() const;
   void clearOutputBuffer();
   void consumeBytes(size_t bytes);
-  std::string peekOutputBuffer() const;
+  void updateSendqPeak();
+  size_t fillIovec(struct iovec *iov, size_t maxIov) const;
 
   // Channel tracking (used later)
   void joinChannel(Channel *channel);
@@ -79,15 +139,28 @@ public:
 
 private:
   int _fd; // socket fd for this client
+  unsigned long _id; // unique per connection, fds get reused
+  Reactor *_owner;   // reactor thread doing this client's I/O
   std::string _nickname;
   std::string _username;
   std::string _realname;
   bool _authenticated; // true after PASS+NICK+USER
   bool _hasValidPass;
+  bool _oper;          // true after a successful OPER
+  uint64_t _floodClock; // flood control: when the token bucket is full again
+  bool _throttled;      // input deferred until the bucket refills
+  bool _readPending;    // read budget ran out with the socket still readable
+  TimerWheel::Timer _timer; // registration deadline, then keepalive
+  uint64_t _lastActivity;   // monotonicNs() of the last read
+  bool _awaitingPong;       // server PING sent, nothing read since
 
-  std::string _buffer;            // stores partial packets
-  int _outputBufferSize; // total size of _outputBuffer
-  std::deque<std::string> _outputBuffer;         // stores outgoing messages
+  InputBuffer _input;             // stores partial packets
+  size_t _outputBufferSize;       // total size of _outputBuffer
+  OutputQueue _outputBuffer;      // stores outgoing messages
+  size_t _sendqLimit;             // bytes _outputBuffer may hold
+  bool _sendqExceeded;            // over a limit, dropped by the owner
+  std::atomic<size_t> _sendqPeak; // high-water mark of _outputBufferSize,
+                                  // written by the owner only (STATS q)
   std::vector<Channel *> _joined; // channels the client is in
 };
 
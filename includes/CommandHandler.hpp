@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <sys/socket.h>
 
 class Server;
@@ -60,12 +61,14 @@ public:
                           const ParsedCommand &cmd);
   static void handleTOPIC(Server *server, Client *client,
                           const ParsedCommand &cmd);
+  static void handleOPER(Server *server, Client *client,
+                          const ParsedCommand &cmd);
+  static void handleSTATS(Server *server, Client *client,
+                          const ParsedCommand &cmd);
   // internal helpers for command handlers
   private:
-  static bool requireParams(Server *server, Client *client, const ParsedCommand &cmd,
-                   size_t expectedCount, const std::string &cmdName);
   static Channel *expectChannel(Server *server, Client *client,
-                       const std::string &rawName,
+                       std::string_view rawName,
                        const std::string &cmdName, bool mustExist = true,
                        bool requireMember = false, bool requireOperator = false);
   static bool ensureModeTargetProvided(Server *server, Client *client);
@@ -8,11 +8,11 @@
 #include "Replies.hpp"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 # include <cstdlib>
 
-std::string ensureChannelPrefix(const std::string &name);
-std::string makePrefix(Client *client);
-std::vector<std::string> splitCommaList(const std::string &list);
+std::string ensureChannelPrefix(std::string_view name);
+std::vector<std::string> splitCommaList(std::string_view list);
 # endif
\ No newline at end of file
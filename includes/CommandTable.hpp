@@ -0,0 +1,69 @@
+#ifndef COMMANDTABLE_HPP
+#define COMMANDTABLE_HPP
+
+#include "Parser.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+
+class Server;
+class Client;
+
+typedef void (*CommandFn)(Server *server, Client *client,
+                          const ParsedCommand &cmd);
+
+/**
+ * @brief Everything the dispatcher needs to know about one command.
+ *
+ * Steps:
+ *  - requiresRegistration: answer ERR_NOTREGISTERED (451) before
+ *    PASS/NICK/USER are done
+ *  - minParams: answer ERR_NEEDMOREPARAMS (461) with fewer middles
+ *  - lock: how much of Server::_stateLock the handler needs (LockMode)
+ *  - cost: flood control tokens charged per line (see Reactor::processInput);
+ *    higher for commands that fan out or walk shared state
+ *  - calls: number of times the handler ran (all reactors)
+ */
+/**
+ * @brief Side of Server::_stateLock a handler runs under.
+ *
+ * Steps:
+ *  - LOCK_NONE: touches only the sender and what is published for
+ *    lock-free readers (the RCU indexes and channel member views, see
+ *    Rcu); replies go to client->queueMessage(), never sendReply(), which
+ *    reads the client directory
+ *  - LOCK_SHARED: only reads shared state
+ *  - LOCK_EXCLUSIVE: changes channels, nicknames or the client directory
+ */
+enum LockMode { LOCK_NONE, LOCK_SHARED, LOCK_EXCLUSIVE };
+
+struct CommandDescriptor {
+  std::string_view name; // upper case
+  CommandFn handler;
+  size_t minParams;
+  bool requiresRegistration;
+  LockMode lock;
+  unsigned cost;
+  std::atomic<unsigned long> *calls;
+};
+
+/**
+ * @brief Registry of every command the server understands.
+ *
+ * Lookup is a compile-time perfect hash over the case-folded length and
+ * first, second and last letters, followed by one case-insensitive
+ * compare: no allocation and no chain of string comparisons per message.
+ * Adding a command is one line in CommandTable.cpp; a hash collision
+ * fails the build.
+ */
+class CommandTable {
+public:
+  static const CommandDescriptor *find(std::string_view name);
+
+  static size_t size();
+  static const CommandDescriptor &at(size_t index);
+  static size_t indexOf(const CommandDescriptor &desc);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef EPOLLEVENTLOOP_HPP
+#define EPOLLEVENTLOOP_HPP
+
+#include "EventLoop.hpp"
+
+#include <sys/epoll.h>
+#include <vector>
+
+/**
+ * @brief Edge-triggered epoll backend.
+ *
+ * Steps:
+ *  - Every fd is registered once with EPOLLIN | EPOLLET
+ *  - EPOLLOUT is added with EPOLL_CTL_MOD only while output is pending
+ *  - wait() only touches the fds the kernel reports as ready
+ */
+class EpollEventLoop : public EventLoop {
+public:
+  EpollEventLoop();
+  ~EpollEventLoop();
+
+  void add(int fd);
+  void remove(int fd);
+  void setWritable(int fd, bool enable);
+  int wait(std::vector<IoEvent> &events, int timeoutMs);
+
+  bool isEdgeTriggered() const;
+  const char *name() const;
+
+private:
+  int _epollFd;
+  std::vector<epoll_event> _ready;  // kernel output buffer for epoll_wait
+  std::vector<unsigned char> _armed; // fd -> EPOLLOUT currently armed
+
+  EpollEventLoop(const EpollEventLoop &);
+  EpollEventLoop &operator=(const EpollEventLoop &);
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef EVENTLOOP_HPP
+#define EVENTLOOP_HPP
+
+#include "SharedLine.hpp"
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+/**
+ * @brief A notification returned by EventLoop::wait().
+ *
+ * Readiness backends only set the flags. Completion backends (io_uring)
+ * have already done the I/O and also report its result:
+ *  - accepted: fd of a connection accepted on the listener
+ *  - data/length: bytes received, valid until the next wait()
+ *  - sent: bytes written by the last submitSend() for this fd
+ */
+struct IoEvent {
+  int fd;
+  bool readable;
+  bool writable;
+  bool error; // hangup / socket error, treat like a read that will fail
+  int accepted;
+  const char *data;
+  size_t length;
+  long sent;
+
+  IoEvent(int fd = -1)
+      : fd(fd), readable(false), writable(false), error(false), accepted(-1),
+        data(NULL), length(0), sent(0) {}
+};
+
+/**
+ * @brief Small interface over the kernel readiness API used by the server.
+ *
+ * Steps:
+ *  - Register fds for read interest with add()
+ *  - Arm write interest only while a client has queued output
+ *  - wait() fills a list with the fds that are actually ready
+ *  - Implementations: PollEventLoop (portable fallback),
+ *    EpollEventLoop (edge-triggered, Linux) and IoUringEventLoop
+ *    (completion-based, Linux 6.0+)
+ *
+ * Edge-triggered backends only report a transition once, so callers must
+ * read / write / accept until EAGAIN when isEdgeTriggered() is true.
+ * When completesIo() is true the backend accepts, receives and sends by
+ * itself: callers hand output to submitSend() instead of calling send().
+ */
+class EventLoop {
+public:
+  virtual ~EventLoop() {}
+
+  virtual void add(int fd) = 0;
+  virtual void remove(int fd) = 0;
+  virtual void setWritable(int fd, bool enable) = 0;
+  virtual int wait(std::vector<IoEvent> &events, int timeoutMs) = 0;
+
+  virtual bool isEdgeTriggered() const = 0;
+  virtual const char *name() const = 0;
+
+  /* Completion-based backends only */
+  virtual bool completesIo() const { return false; }
+  virtual bool sendInFlight(int fd) const {
+    (void)fd;
+    return false;
+  }
+  virtual void submitSend(int fd, const OutputQueue &queue) {
+    (void)fd;
+    (void)queue;
+  }
+
+  /**
+   * @brief Builds the backend selected on the command line.
+   * @param backend "uring", "epoll" or "poll". Unsupported backends fall
+   * back to the next one in that order.
+   */
+  static EventLoop *create(const std::string &backend);
+};
+
+#endif
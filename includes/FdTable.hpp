@@ -0,0 +1,61 @@
+#ifndef FDTABLE_HPP
+#define FDTABLE_HPP
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Dense table of pointers indexed directly by file descriptor.
+ *
+ * The kernel hands out the lowest free descriptor, so fds stay small and
+ * dense: a vector slot per fd gives O(1) lookup, insert and erase without
+ * hashing or tree walks. Empty slots hold NULL.
+ */
+template <typename T> class FdTable {
+public:
+  FdTable() : _count(0) {}
+
+  T *get(int fd) const {
+    if (fd < 0 || static_cast<size_t>(fd) >= _slots.size())
+      return NULL;
+    return _slots[fd];
+  }
+
+  void set(int fd, T *value) {
+    if (static_cast<size_t>(fd) >= _slots.size())
+      _slots.resize(static_cast<size_t>(fd) + 1 > _slots.size() * 2
+                        ? static_cast<size_t>(fd) + 1
+                        : _slots.size() * 2,
+                    NULL);
+    if (!_slots[fd])
+      ++_count;
+    _slots[fd] = value;
+  }
+
+  /* Returns the removed pointer, NULL if the slot was empty */
+  T *erase(int fd) {
+    T *old = get(fd);
+    if (old) {
+      _slots[fd] = NULL;
+      --_count;
+    }
+    return old;
+  }
+
+  size_t size() const { return _count; }
+  bool empty() const { return _count == 0; }
+
+  /* Every fd in [0, capacity()) may be probed with get() */
+  int capacity() const { return static_cast<int>(_slots.size()); }
+
+  void clear() {
+    _slots.clear();
+    _count = 0;
+  }
+
+private:
+  std::vector<T *> _slots;
+  size_t _count;
+};
+
+#endif
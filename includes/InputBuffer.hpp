@@ -0,0 +1,69 @@
+#ifndef INPUTBUFFER_HPP
+#define INPUTBUFFER_HPP
+
+#include "ObjectPool.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief Fixed-capacity linear receive buffer of one client.
+ *
+ * Steps:
+ *  - recv() writes straight into writePtr() / writeSpace(), then commit()
+ *  - nextLine() hands out complete lines as views into the buffer
+ *    (CR/LF stripped) without copying them
+ *  - Consumed bytes are reclaimed by resetting to the front when empty,
+ *    or by moving the partial line back when the free tail gets short
+ *  - "Short" adapts to the client: recordRead() widens the wanted tail
+ *    for clients whose reads fill it and narrows it again for ones that
+ *    send a line at a time, so bursts land in place in one read while
+ *    chatty clients do not pay a move per read
+ *
+ * A view stays valid until the next writePtr() / append(). The storage is
+ * allocated on the first write, so idle connections cost nothing. When a
+ * BlockPool is attached it comes from there instead of the heap.
+ */
+class InputBuffer {
+public:
+  /* Longest unterminated input a client may have pending */
+  static const size_t CAPACITY = 8192;
+  /* Bounds of the free tail wanted before a read */
+  static const size_t MIN_TAIL = CAPACITY / 8;
+  static const size_t MAX_TAIL = CAPACITY / 2;
+
+  struct Block {
+    char bytes[CAPACITY];
+    Block() {} // leave the bytes uninitialized
+  };
+  typedef ObjectPool<Block, 64> BlockPool;
+
+  InputBuffer();
+  ~InputBuffer();
+
+  char *writePtr();
+  size_t writeSpace() const;
+  void commit(size_t bytes);
+  void recordRead(size_t bytes);
+  size_t append(const char *data, size_t length);
+
+  bool nextLine(std::string_view &line);
+  void unread(std::string_view line);
+  bool overflowed() const;
+  size_t size() const;
+  void clear();
+  void setPool(BlockPool *pool);
+
+private:
+  BlockPool *_pool; // NULL: plain heap allocation
+  Block *_data;
+  size_t _start; // first unconsumed byte
+  size_t _end;   // one past the last received byte
+  size_t _scan;  // bytes before this are known to contain no '\n'
+  size_t _tail;  // free tail wanted before a read, MIN_TAIL..MAX_TAIL
+
+  InputBuffer(const InputBuffer &);
+  InputBuffer &operator=(const InputBuffer &);
+};
+
+#endif
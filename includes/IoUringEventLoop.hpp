@@ -0,0 +1,115 @@
+#ifndef IOURINGEVENTLOOP_HPP
+#define IOURINGEVENTLOOP_HPP
+
+#include "EventLoop.hpp"
+
+#include <linux/io_uring.h>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+/**
+ * @brief Completion-based io_uring backend (raw syscalls, no liburing).
+ *
+ * Steps:
+ *  - Listening sockets get one multishot accept
+ *  - Client sockets get one multishot recv that picks its buffers from a
+ *    provided-buffer ring shared by all clients of this loop
+ *  - Other fds (the reactor eventfd) get a multishot poll
+ *  - Sends are queued as SENDMSG SQEs over the client's output queue,
+ *    without copying it (one in flight per client)
+ *  - wait() submits everything queued since the last call and reaps
+ *    completions in a single io_uring_enter
+ *
+ * Requests are tagged with a per-fd generation so completions that arrive
+ * after remove() (or for a reused fd number) are recognised and dropped.
+ */
+class IoUringEventLoop : public EventLoop {
+public:
+  IoUringEventLoop();
+  ~IoUringEventLoop();
+
+  void add(int fd);
+  void remove(int fd);
+  void setWritable(int fd, bool enable);
+  int wait(std::vector<IoEvent> &events, int timeoutMs);
+
+  bool isEdgeTriggered() const;
+  const char *name() const;
+
+  bool completesIo() const;
+  bool sendInFlight(int fd) const;
+  void submitSend(int fd, const OutputQueue &queue);
+
+private:
+  enum Kind { NONE, LISTENER, CONNECTION, POLLED };
+
+  /**
+   * @brief One SENDMSG in flight. Holds a reference on every line it
+   * points into, so the bytes stay valid until the kernel is done.
+   */
+  struct SendState {
+    std::vector<SharedLine> lines;
+    std::vector<iovec> iov;
+    msghdr msg;
+  };
+
+  struct Slot {
+    uint32_t gen;
+    Kind kind;
+    std::unique_ptr<SendState> send; // non-null while a send is in flight
+    Slot() : gen(0), kind(NONE) {}
+  };
+
+  int _ringFd;
+  unsigned _pending; // SQEs prepared but not yet submitted
+
+  // submission queue
+  void *_sqMap;
+  size_t _sqMapSize;
+  unsigned *_sqHead;
+  unsigned *_sqTail;
+  unsigned _sqMask;
+  unsigned _sqEntries;
+  unsigned *_sqArray;
+  io_uring_sqe *_sqes;
+  size_t _sqesSize;
+
+  // completion queue
+  void *_cqMap;
+  size_t _cqMapSize;
+  unsigned *_cqHead;
+  unsigned *_cqTail;
+  unsigned _cqMask;
+  io_uring_cqe *_cqes;
+
+  // provided receive buffers
+  io_uring_buf_ring *_bufRing;
+  size_t _bufRingSize;
+  uint16_t _bufTail;
+  char *_bufBase;
+  std::vector<uint16_t> _recycle; // buffers handed out by the last wait()
+
+  std::vector<Slot> _slots;                  // indexed by fd
+  std::map<uint64_t, std::unique_ptr<SendState> > _orphans; // outlive fd
+
+  Slot &slot(int fd);
+  io_uring_sqe *nextSqe();
+  void armAccept(int fd);
+  void armRecv(int fd);
+  void armPoll(int fd);
+  void cancel(uint64_t userData);
+  void provideBuffer(uint16_t bid);
+  void publishBuffers();
+  void setup();
+  void teardown();
+
+  IoUringEventLoop(const IoUringEventLoop &);
+  IoUringEventLoop &operator=(const IoUringEventLoop &);
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef MEMBERTABLE_HPP
+#define MEMBERTABLE_HPP
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+class Client;
+
+/**
+ * @brief Per-channel membership store: one record per client handle.
+ *
+ * Steps:
+ *  - Records live in an open-addressing (linear probing) hash keyed by the
+ *    Client pointer, so every membership/status test is a short probe
+ *  - Clients come from a pool that hands a freed address to the next
+ *    connection, so each record also stores the connection id; a record
+ *    whose id no longer matches is stale and is never reported
+ *  - Each record packs the client's status bits (member, op, voice,
+ *    invited) and its position in the dense member array
+ *  - The member array is what broadcasts iterate; removal swaps the last
+ *    member into the hole instead of shifting the array
+ *  - Deletion uses backward shifting, so the table never fills with
+ *    tombstones
+ *
+ * Only members carry OPERATOR/VOICE; INVITED is the one bit a non-member
+ * can hold. A record disappears as soon as its last status bit is cleared. Each
+ * record also carries an opaque tag for the owner (Channel stores the
+ * NAMES chunk of the member there).
+ */
+class MemberTable {
+public:
+  enum Flag {
+    MEMBER = 1 << 0,
+    OPERATOR = 1 << 1,
+    VOICE = 1 << 2,
+    INVITED = 1 << 3
+  };
+
+  MemberTable();
+  ~MemberTable();
+
+  bool add(Client *client);
+  bool remove(Client *client);
+  bool contains(Client *client) const;
+
+  bool setFlags(Client *client, uint8_t flags);
+  void clearFlags(Client *client, uint8_t flags);
+  bool hasFlags(Client *client, uint8_t flags) const;
+  uint8_t flagsOf(Client *client) const;
+  uint32_t tagOf(Client *client) const;
+  void setTag(Client *client, uint32_t tag);
+  void clearFlagsEverywhere(uint8_t flags);
+
+  const std::vector<Client *> &members() const;
+  size_t size() const;
+  bool empty() const;
+
+private:
+  static const uint32_t NO_SLOT = 0xffffffffu;
+
+  struct Record {
+    Client *client;  // NULL marks an empty bucket
+    unsigned long id; // Client::getId() when the record was made
+    uint32_t member; // index in _members, NO_SLOT if not a member
+    uint32_t tag;
+    uint8_t flags;
+  };
+
+  std::vector<Record> _buckets; // power-of-two sized
+  size_t _used;                 // occupied buckets
+  std::vector<Client *> _members;
+
+  size_t home(const Client *client) const;
+  size_t probe(const Client *client) const;
+  Record *find(const Client *client);
+  const Record *find(const Client *client) const;
+  Record &insert(Client *client);
+  void purgeAt(size_t pos);
+  void eraseAt(size_t pos);
+  void dropIfUnused(Record &rec);
+  void rehash(size_t capacity);
+};
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @brief Monotonic counter. add() is one relaxed atomic increment.
+ */
+class Counter {
+public:
+  Counter() : _value(0) {}
+
+  void add(uint64_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> _value;
+
+  Counter(const Counter &);
+  Counter &operator=(const Counter &);
+};
+
+/**
+ * @brief Value that goes up and down (connected clients, channels).
+ */
+class Gauge {
+public:
+  Gauge() : _value(0) {}
+
+  void set(int64_t v) { _value.store(v, std::memory_order_relaxed); }
+  void add(int64_t n) { _value.fetch_add(n, std::memory_order_relaxed); }
+  int64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> _value;
+
+  Gauge(const Gauge &);
+  Gauge &operator=(const Gauge &);
+};
+
+/**
+ * @brief Distribution over fixed power-of-two buckets.
+ *
+ * Steps:
+ *  - Bucket i counts observations <= 2^i (raw units: ns, bytes, members);
+ *    the last bucket takes everything larger
+ *  - observe() finds the bucket with one count-leading-zeros and does
+ *    three relaxed atomic adds, so it never allocates or locks
+ *  - scale converts raw units for export (1e-9 turns ns into seconds)
+ */
+class Histogram {
+public:
+  static const int MAX_BUCKETS = 48;
+
+  Histogram(int buckets, double scale = 1.0);
+
+  void observe(uint64_t value) {
+    int i = value <= 1 ? 0 : 64 - __builtin_clzll(value - 1);
+    if (i >= _buckets)
+      i = _buckets; // overflow bucket (+Inf)
+    _counts[i].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void assign(const Histogram &other);
+
+  int buckets() const { return _buckets; }
+  double scale() const { return _scale; }
+  uint64_t bucketCount(int i) const;
+  uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+  uint64_t percentile(double q) const;
+
+private:
+  int _buckets; // finite buckets; _counts[_buckets] is +Inf
+  double _scale;
+  std::atomic<uint64_t> _counts[MAX_BUCKETS + 1];
+  std::atomic<uint64_t> _count;
+  std::atomic<uint64_t> _sum;
+
+  Histogram(const Histogram &);
+  Histogram &operator=(const Histogram &);
+};
+
+/**
+ * @brief HDR-style latency histogram over CPU ticks.
+ *
+ * Steps:
+ *  - Log-linear buckets: 8 linear sub-buckets per power of two, so any
+ *    quantile is within 12.5% of the true value over the whole 64-bit range
+ *  - Values below 16 ticks are exact
+ *  - Single writer: observe() is a relaxed load and store of the bucket and
+ *    the sum (no locked instruction); other threads may read concurrently
+ *  - The sample count is the sum of the buckets, computed when read
+ *
+ * Ticks are converted to time with ticksPerNs() when the histogram is read.
+ */
+class LatencyHistogram {
+public:
+  static const int SUB_BITS = 3;
+  static const int SUB = 1 << SUB_BITS;
+  static const int BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+  LatencyHistogram();
+
+  void observe(uint64_t ticks) {
+    bump(_counts[index(ticks)], 1);
+    bump(_sum, ticks);
+  }
+
+  void merge(const LatencyHistogram &other);
+
+  uint64_t count() const;
+  uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+  uint64_t quantile(double q) const;
+
+private:
+  std::atomic<uint64_t> _counts[BUCKETS];
+  std::atomic<uint64_t> _sum;
+
+  static void bump(std::atomic<uint64_t> &slot, uint64_t n) {
+    slot.store(slot.load(std::memory_order_relaxed) + n,
+               std::memory_order_relaxed);
+  }
+  static int index(uint64_t v) {
+    if (v < 2 * SUB)
+      return static_cast<int>(v);
+    int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+    return (shift + 1) * SUB + static_cast<int>((v >> shift) & (SUB - 1));
+  }
+  static uint64_t lowerBound(int i);
+
+  LatencyHistogram(const LatencyHistogram &);
+  LatencyHistogram &operator=(const LatencyHistogram &);
+};
+
+/**
+ * @brief A fixed number of latency series, sharded per thread.
+ *
+ * Steps:
+ *  - A thread gets its own array of histograms on its first local() call
+ *    (the only allocation); every later observation writes memory no other
+ *    thread writes, so reactors never share a cache line here
+ *  - collect() merges one series across all shards into a caller-owned
+ *    histogram; shards outlive their thread, so samples of joined reactors
+ *    still show up in the shutdown report
+ *  - At most MAX_TABLES tables exist per process (one slot each in the
+ *    thread-local shard cache)
+ */
+class LatencyTable {
+public:
+  static const int MAX_TABLES = 4;
+
+  explicit LatencyTable(size_t series);
+  ~LatencyTable();
+
+  LatencyHistogram *local() {
+    LatencyHistogram *shard = _localShards[_slot];
+    return shard ? shard : attach();
+  }
+
+  size_t series() const { return _series; }
+  void collect(size_t series, LatencyHistogram &out) const;
+
+private:
+  size_t _series;
+  int _slot;
+  mutable std::mutex _lock; // guards _shards
+  std::vector<LatencyHistogram *> _shards;
+
+  static std::atomic<int> _nextSlot;
+  static thread_local LatencyHistogram *_localShards[MAX_TABLES];
+
+  LatencyHistogram *attach();
+
+  LatencyTable(const LatencyTable &);
+  LatencyTable &operator=(const LatencyTable &);
+};
+
+/**
+ * @brief Names, help texts and labels of the exported metrics.
+ *
+ * Metrics are registered once at startup (this is where allocation
+ * happens) and only read afterwards, by the Prometheus endpoint and STATS.
+ * Series of one family share a name and differ by their label. Latency
+ * histograms are exported as summaries (quantiles, sum and count in
+ * seconds) to keep the number of series small.
+ */
+class MetricsRegistry {
+public:
+  void add(const char *name, const char *help, Counter &counter,
+           const std::string &label = "");
+  void add(const char *name, const char *help, Gauge &gauge,
+           const std::string &label = "");
+  void add(const char *name, const char *help, Histogram &histogram,
+           const std::string &label = "");
+  void add(const char *name, const char *help, LatencyTable &table,
+           size_t series, const std::string &label = "");
+
+  void renderPrometheus(std::string &out) const;
+  void renderStats(std::vector<std::string> &lines) const;
+
+private:
+  enum Kind { COUNTER, GAUGE, HISTOGRAM, SUMMARY };
+
+  struct Entry {
+    const char *name;
+    const char *help;
+    Kind kind;
+    std::string label; // e.g. command="JOIN", empty for none
+    const void *metric;
+    size_t series; // series of a LatencyTable
+  };
+
+  std::vector<Entry> _entries;
+
+  void push(const char *name, const char *help, Kind kind,
+            const std::string &label, const void *metric, size_t series = 0);
+};
+
+/**
+ * @brief Every metric the server records, plus their registry.
+ *
+ * Hot paths update the fields directly through metrics(); nothing here
+ * allocates after construction (except each thread's latency shard, once).
+ * Per-command series are indexed by the command's position in
+ * CommandTable.
+ */
+struct ServerMetrics {
+  static const size_t MAX_COMMANDS = 32;
+  /* latency series: 0..MAX_COMMANDS-1 handler time, then dispatch delay */
+  static const size_t DISPATCH_DELAY = MAX_COMMANDS;
+
+  Counter connectionsAccepted;
+  Counter connectionsClosed;
+  Gauge clients;
+  Counter messagesIn[MAX_COMMANDS];
+  Counter messagesOut[MAX_COMMANDS]; // lines queued while running it
+  Counter unknownCommands;
+  Counter floodThrottled;   // times a client's input was deferred
+  Counter floodDisconnects; // clients dropped with "Excess Flood"
+  Counter pingsSent;        // keepalive PINGs to idle clients
+  Counter pingTimeouts;     // clients dropped for not answering one
+  Counter registrationTimeouts; // clients dropped before registering
+  Counter sendqDisconnects; // clients dropped with "SendQ exceeded"
+  Counter bytesReceived;
+  Counter bytesSent;
+  Histogram recvBytes;        // bytes per receive call, 0 for EAGAIN
+  Histogram sendBytes;        // bytes per send call, 0 for EAGAIN
+  Histogram outputQueueBytes; // queued bytes at each flush attempt
+  Histogram loopIterationTime; // ns from wakeup to the next wait
+  Gauge channels;             // refreshed when metrics are read
+  Histogram channelMembers;   // refreshed when metrics are read
+  Gauge sendqBytes;           // refreshed: output queued for all clients
+  Histogram sendqPeak;        // refreshed: send queue high-water marks
+  LatencyTable latency; // handler wall time, line read -> handler start
+
+  MetricsRegistry registry;
+
+  /* Lines queued by this thread; handleCommand charges the difference
+   * across a handler to messagesOut, so broadcasts touch no atomics */
+  static thread_local uint64_t queuedLines;
+
+  ServerMetrics();
+
+private:
+  ServerMetrics(const ServerMetrics &);
+  ServerMetrics &operator=(const ServerMetrics &);
+};
+
+ServerMetrics &metrics();
+
+/* CLOCK_MONOTONIC in nanoseconds (vDSO, no syscall) */
+uint64_t monotonicNs();
+
+/* Cheapest timestamp available: the TSC on x86, monotonicNs() elsewhere */
+inline uint64_t cpuTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return monotonicNs();
+#endif
+}
+
+/* cpuTicks() per nanosecond, measured against CLOCK_MONOTONIC */
+double ticksPerNs();
+
+#endif
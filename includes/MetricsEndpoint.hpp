@@ -0,0 +1,62 @@
+#ifndef METRICSENDPOINT_HPP
+#define METRICSENDPOINT_HPP
+
+#include "EventLoop.hpp"
+#include "SharedLine.hpp"
+
+#include <map>
+#include <string>
+
+class Server;
+
+/**
+ * @brief Minimal HTTP listener on 127.0.0.1 serving GET /metrics in the
+ * Prometheus text format.
+ *
+ * Steps:
+ *  - Owned by reactor 0 and driven by its EventLoop: the listener and
+ *    scrape connections are ordinary fds of that loop
+ *  - A connection is answered as soon as its request headers are in,
+ *    then closed (no keep-alive)
+ *  - The response is flushed like client output: non-blocking writes,
+ *    write interest armed while the scraper's socket is full, so a slow
+ *    scraper never holds up the clients of reactor 0
+ */
+class MetricsEndpoint {
+public:
+  MetricsEndpoint(Server *server, EventLoop *loop);
+  ~MetricsEndpoint();
+
+  void open(int port);
+  bool owns(int fd) const;
+  void handle(const IoEvent &ev);
+
+private:
+  /* Requests larger than this are answered without waiting for more */
+  static const size_t MAX_REQUEST = 4096;
+
+  struct Connection {
+    std::string request;  // received so far, until the headers are in
+    OutputQueue response; // rendered answer and how much of it was sent
+    bool answered;
+  };
+
+  Server *_server;
+  EventLoop *_loop;
+  int _listenFd;
+  std::map<int, Connection> _connections; // by scrape connection fd
+
+  void acceptAll();
+  void adopt(int fd);
+  void readAll(int fd);
+  void receive(int fd, const char *data, size_t length);
+  void respond(Connection &conn);
+  void flush(int fd);
+  void consume(int fd, long sent);
+  void closeConnection(int fd);
+
+  MetricsEndpoint(const MetricsEndpoint &);
+  MetricsEndpoint &operator=(const MetricsEndpoint &);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef NAMESCACHE_HPP
+#define NAMESCACHE_HPP
+
+#include "SharedLine.hpp"
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Pre-chunked RPL_NAMREPLY payloads of one channel.
+ *
+ * Steps:
+ *  - Member tokens ("nick" or "@nick") are packed into chunks whose size
+ *    keeps a full 353 line, header included, within 512 bytes
+ *  - add/remove/replace touch a single chunk: the caller remembers which
+ *    one holds each member (MemberTable keeps that index)
+ *  - Each chunk caches its "names\r\n" bytes as a SharedLine, rebuilt only
+ *    after the chunk changed, so a JOIN just queues references to them
+ *
+ * Chunks emptied by removals stay in place (indices are stable) and are
+ * refilled by later adds.
+ */
+class NamesCache {
+public:
+  explicit NamesCache(const std::string &channel);
+  ~NamesCache();
+
+  uint32_t add(std::string_view token);
+  void remove(uint32_t chunk, std::string_view token);
+  uint32_t replace(uint32_t chunk, std::string_view oldToken,
+                   std::string_view newToken);
+
+  void collect(std::vector<SharedLine> &lines);
+  size_t chunkCount() const;
+
+private:
+  struct Chunk {
+    std::string text;  // space-separated tokens, no CRLF
+    SharedLine cached; // text + CRLF; NULL when text changed since
+  };
+
+  std::vector<Chunk> _chunks;
+  size_t _budget; // max text bytes per chunk
+
+  bool fits(const Chunk &chunk, std::string_view token) const;
+  static size_t find(const std::string &text, std::string_view token);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef OBJECTPOOL_HPP
+#define OBJECTPOOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Typed slab allocator with an intrusive free list.
+ *
+ * Steps:
+ *  - Storage is carved out of slabs of SlabSize objects; a slab is never
+ *    returned to the heap before the pool dies, so churn (reconnect storms)
+ *    recycles the same memory instead of fragmenting the heap
+ *  - create() pops a free slot and constructs in place, destroy() runs the
+ *    destructor and pushes the slot back
+ *  - Occupancy counters are atomics so other threads may read them (STATS)
+ *
+ * create()/destroy() are not synchronized: each pool has one owning thread,
+ * or is only used under a lock held by its owner.
+ */
+template <typename T, size_t SlabSize = 256> class ObjectPool {
+public:
+  ObjectPool() : _free(NULL), _capacity(0), _inUse(0), _peak(0) {}
+
+  /* Every object must have been destroyed by now */
+  ~ObjectPool() {
+    for (size_t i = 0; i < _slabs.size(); ++i)
+      delete[] _slabs[i];
+  }
+
+  template <typename... Args> T *create(Args &&...args) {
+    if (!_free)
+      grow();
+    Node *node = _free;
+    _free = node->next;
+    try {
+      T *object = new (node->storage) T(std::forward<Args>(args)...);
+      size_t used = _inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+      if (used > _peak.load(std::memory_order_relaxed))
+        _peak.store(used, std::memory_order_relaxed);
+      return object;
+    } catch (...) {
+      node->next = _free;
+      _free = node;
+      throw;
+    }
+  }
+
+  void destroy(T *object) {
+    if (!object)
+      return;
+    object->~T();
+    Node *node = reinterpret_cast<Node *>(object);
+    node->next = _free;
+    _free = node;
+    _inUse.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /* Pre-allocates slabs until at least count objects fit */
+  void reserve(size_t count) {
+    while (_capacity.load(std::memory_order_relaxed) < count)
+      grow();
+  }
+
+  size_t inUse() const { return _inUse.load(std::memory_order_relaxed); }
+  size_t capacity() const { return _capacity.load(std::memory_order_relaxed); }
+  size_t peak() const { return _peak.load(std::memory_order_relaxed); }
+
+private:
+  union Node {
+    Node *next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  std::vector<Node *> _slabs;
+  Node *_free;
+  std::atomic<size_t> _capacity;
+  std::atomic<size_t> _inUse;
+  std::atomic<size_t> _peak;
+
+  void grow() {
+    Node *slab = new Node[SlabSize];
+    _slabs.push_back(slab);
+    for (size_t i = SlabSize; i > 0; --i) {
+      slab[i - 1].next = _free;
+      _free = &slab[i - 1];
+    }
+    _capacity.fetch_add(SlabSize, std::memory_order_relaxed);
+  }
+
+  ObjectPool(const ObjectPool &);
+  ObjectPool &operator=(const ObjectPool &);
+};
+
+#endif
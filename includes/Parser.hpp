@@ -13,21 +13,50 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
-#include <string>
-#include <vector>
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief Fixed-capacity list of middle parameters (no heap allocation).
+ *
+ * RFC 1459 allows at most 15 parameters per message; the parser stops
+ * splitting after MAX_PARAMS - 1 middles and hands the rest of the line
+ * over as the trailing parameter.
+ */
+class ParamList {
+public:
+  static const size_t MAX_PARAMS = 15;
+
+  ParamList() : _count(0) {}
+
+  size_t size() const { return _count; }
+  bool empty() const { return _count == 0; }
+  const std::string_view &operator[](size_t i) const { return _items[i]; }
+  void push_back(std::string_view param) { _items[_count++] = param; }
+
+private:
+  std::string_view _items[MAX_PARAMS];
+  size_t _count;
+};
 
 /**
  * @brief Represents a parsed IRC command.
  *
  * Steps:
+ *  - Store the IRCv3 tags (without '@') and the prefix (without ':')
  *  - Store the command name
  *  - Store all parameters before the trailing part
  *  - Store the trailing message (if present, begins with ':')
+ *
+ * Every field is a view into the line that was parsed, so the line must
+ * outlive the ParsedCommand.
  */
 struct ParsedCommand {
-  std::string command;
-  std::vector<std::string> params;
-  std::string trailing;
+  std::string_view tags;
+  std::string_view prefix;
+  std::string_view command;
+  ParamList params;
+  std::string_view trailing;
 };
 
 /**
@@ -35,25 +64,26 @@ struct ParsedCommand {
  *
  * Steps:
  *  - Take a raw IRC line (without CRLF)
- *  - Split the first token as the command
+ *  - Skip an optional "@tags" and ":prefix"
+ *  - Split the next token as the command
  *  - Collect parameters until a token begins with ':'
- *  - Store the rest as trailing text
+ *  - Store the rest as trailing text, spaces preserved
  */
 class Parser {
 public:
   /**
-   * @brief Parses a raw IRC command into components.
+   * @brief Parses a raw IRC command into components in a single pass.
    *
    * Steps:
-   *  - Split message into tokens by spaces
-   *  - First token -> command
-   *  - Tokens before ':' -> params
-   *  - Everything after ':' -> trailing
+   *  - Leading '@' token -> tags, leading ':' token -> prefix
+   *  - Next token -> command
+   *  - Tokens before ':' -> params (runs of spaces separate them)
+   *  - Everything after ':' -> trailing, verbatim
    *
    * @param line Raw IRC message without "\r\n".
-   * @return ParsedCommand Structure containing the parsed result.
+   * @return ParsedCommand Views into line; nothing is copied.
    */
-  static ParsedCommand parse(const std::string &line);
+  static ParsedCommand parse(std::string_view line);
 };
 
 #endif
@@ -0,0 +1,38 @@
+#ifndef POLLEVENTLOOP_HPP
+#define POLLEVENTLOOP_HPP
+
+#include "EventLoop.hpp"
+
+#include <poll.h>
+#include <vector>
+
+/**
+ * @brief Level-triggered poll() backend.
+ *
+ * Keeps one pollfd per watched fd in a dense vector, plus an fd-indexed
+ * table of positions in it so lookups are O(1) and removal is a
+ * swap-and-pop. Every wait() still hands the whole vector to the kernel, so
+ * its cost grows with the number of connections; it is kept as a portable
+ * fallback for systems without epoll.
+ */
+class PollEventLoop : public EventLoop {
+public:
+  PollEventLoop();
+  ~PollEventLoop();
+
+  void add(int fd);
+  void remove(int fd);
+  void setWritable(int fd, bool enable);
+  int wait(std::vector<IoEvent> &events, int timeoutMs);
+
+  bool isEdgeTriggered() const;
+  const char *name() const;
+
+private:
+  std::vector<pollfd> _pollfds;
+  std::vector<int> _index; // fd -> position in _pollfds, -1 if not watched
+
+  pollfd *find(int fd);
+};
+
+#endif
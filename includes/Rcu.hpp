@@ -0,0 +1,66 @@
+#ifndef RCU_HPP
+#define RCU_HPP
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Quiescent-state based reclamation for the lock-free read paths
+ * (PRIVMSG, see CommandDescriptor::lock).
+ *
+ * Steps:
+ *  - A writer, holding Server::_stateLock exclusively, publishes the new
+ *    version of a structure with a release store and retire()s the old
+ *    one: its deleter is tagged with a fresh epoch
+ *  - Every reactor thread owns a Reader. online() records the epoch it
+ *    has seen; offline(), right before it blocks in wait(), says it holds
+ *    no reference at all. Between the two a reader may keep any pointer
+ *    it loaded
+ *  - A deleter runs once every online reader has seen its epoch, from a
+ *    later retire() (so under the writers' lock as well)
+ *  - Threads that never register (the benches) are not waited for; they
+ *    must not read while another thread writes
+ *
+ * Readers never wait and pay two stores and a fence per loop iteration;
+ * writers never wait either, old versions are freed lazily.
+ */
+class Rcu {
+public:
+  struct Reader {
+    Reader() : seen(0) {}
+    alignas(64) std::atomic<uint64_t> seen; // 0 while offline
+  };
+
+  Rcu();
+  ~Rcu();
+
+  void registerReader(Reader &reader);
+  void unregisterReader(Reader &reader);
+  void online(Reader &reader);
+  void offline(Reader &reader);
+
+  void retire(std::function<void()> deleter);
+  void drain();
+
+private:
+  struct Retired {
+    uint64_t epoch;
+    std::function<void()> deleter;
+  };
+
+  std::atomic<uint64_t> _epoch;
+  std::mutex _mutex; // guards the two members below
+  std::vector<Reader *> _readers;
+  std::deque<Retired> _retired; // oldest (lowest epoch) first
+
+  Rcu(const Rcu &);
+  Rcu &operator=(const Rcu &);
+};
+
+Rcu &rcu();
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef RCUMAP_HPP
+#define RCUMAP_HPP
+
+#include "Rcu.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief String-keyed hash map readers search without a lock.
+ *
+ * Steps:
+ *  - Chained buckets of immutable nodes; a reader loads the table and a
+ *    bucket head (acquire) and walks the chain, nothing else
+ *  - insert() of a new key prepends a node with one release store
+ *  - Replacing or erasing a key publishes a copy of its (short) chain
+ *    without the old node, growing publishes a rehashed copy of the whole
+ *    table; what they replace is handed to rcu()
+ *
+ * Writers are serialized by the caller (Server::_stateLock, exclusive).
+ * A pointer returned by find() stays valid until the reader's next
+ * quiescent state (see Rcu).
+ */
+template <typename T> class RcuMap {
+public:
+  RcuMap() : _table(new Table(INITIAL_BUCKETS)), _size(0) {}
+
+  ~RcuMap() {
+    Table *table = _table.load(std::memory_order_relaxed);
+    std::vector<const Node *> nodes;
+    table->collect(nodes);
+    freeAll(table, nodes);
+  }
+
+  const T *find(std::string_view key) const {
+    const Table *table = _table.load(std::memory_order_acquire);
+    const Node *node =
+        table->buckets[hashOf(key) & table->mask].load(std::memory_order_acquire);
+    for (; node; node = node->next) {
+      if (node->key == key)
+        return &node->value;
+    }
+    return NULL;
+  }
+
+  void insert(const std::string &key, const T &value) {
+    Table *table = _table.load(std::memory_order_relaxed);
+    if (rebuildChain(table, key, &value))
+      return;
+    if (_size + 1 > table->buckets.size()) {
+      grow();
+      table = _table.load(std::memory_order_relaxed);
+    }
+    std::atomic<const Node *> &head = table->buckets[hashOf(key) & table->mask];
+    head.store(new Node(key, value, head.load(std::memory_order_relaxed)),
+               std::memory_order_release);
+    ++_size;
+  }
+
+  bool erase(std::string_view key) {
+    if (!rebuildChain(_table.load(std::memory_order_relaxed), key, NULL))
+      return false;
+    --_size;
+    return true;
+  }
+
+  size_t size() const { return _size; }
+
+private:
+  static const size_t INITIAL_BUCKETS = 64; // power of two
+
+  struct Node {
+    Node(const std::string &k, const T &v, const Node *n)
+        : key(k), value(v), next(n) {}
+    std::string key;
+    T value;
+    const Node *next; // set before the node is published, never changed
+  };
+
+  struct Table {
+    explicit Table(size_t count) : mask(count - 1), buckets(count) {
+      for (size_t i = 0; i < count; ++i)
+        buckets[i].store(NULL, std::memory_order_relaxed);
+    }
+    void collect(std::vector<const Node *> &nodes) const {
+      for (size_t i = 0; i < buckets.size(); ++i) {
+        const Node *n = buckets[i].load(std::memory_order_relaxed);
+        for (; n; n = n->next)
+          nodes.push_back(n);
+      }
+    }
+    size_t mask;
+    std::vector<std::atomic<const Node *> > buckets;
+  };
+
+  std::atomic<Table *> _table;
+  size_t _size; // writers only
+
+  static size_t hashOf(std::string_view key) {
+    return std::hash<std::string_view>()(key);
+  }
+
+  static void freeAll(Table *table, const std::vector<const Node *> &nodes) {
+    for (size_t i = 0; i < nodes.size(); ++i)
+      delete nodes[i];
+    delete table;
+  }
+
+  /**
+   * @brief Publishes key's bucket rebuilt without key, with value in
+   * front when given, and retires the old chain.
+   * @return false, changing nothing, when key is not in the map.
+   */
+  bool rebuildChain(Table *table, std::string_view key, const T *value) {
+    std::atomic<const Node *> &head = table->buckets[hashOf(key) & table->mask];
+    const Node *old = head.load(std::memory_order_relaxed);
+    const Node *found = old;
+    while (found && found->key != key)
+      found = found->next;
+    if (!found)
+      return false;
+
+    std::vector<const Node *> chain;
+    const Node *copy = NULL;
+    for (const Node *n = old; n; n = n->next) {
+      chain.push_back(n);
+      if (n != found)
+        copy = new Node(n->key, n->value, copy); // order does not matter
+    }
+    if (value)
+      copy = new Node(found->key, *value, copy);
+    head.store(copy, std::memory_order_release);
+    rcu().retire([chain] { freeAll(NULL, chain); });
+    return true;
+  }
+
+  void grow() {
+    Table *old = _table.load(std::memory_order_relaxed);
+    Table *table = new Table(old->buckets.size() * 2);
+    std::vector<const Node *> nodes;
+    old->collect(nodes);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      std::atomic<const Node *> &head =
+          table->buckets[hashOf(nodes[i]->key) & table->mask];
+      head.store(new Node(nodes[i]->key, nodes[i]->value,
+                          head.load(std::memory_order_relaxed)),
+                 std::memory_order_relaxed);
+    }
+    _table.store(table, std::memory_order_release);
+    rcu().retire([old, nodes] { freeAll(old, nodes); });
+  }
+
+  RcuMap(const RcuMap &);
+  RcuMap &operator=(const RcuMap &);
+};
+
+#endif
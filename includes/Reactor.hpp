@@ -0,0 +1,193 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include "Client.hpp"
+#include "EventLoop.hpp"
+#include "FdTable.hpp"
+#include "ObjectPool.hpp"
+#include "Rcu.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MetricsEndpoint;
+class Server;
+
+/**
+ * @brief One event-loop thread ("shard") of the server.
+ *
+ * Steps:
+ *  - Own a listening socket bound with SO_REUSEPORT, so the kernel spreads
+ *    new connections across all reactors
+ *  - Own an EventLoop and every Client accepted on that listener
+ *  - Do all socket I/O for its clients on its own thread
+ *  - Receive output for its clients from other threads through an inbox
+ *    that is drained when its eventfd fires
+ *
+ * Shared IRC state (channels, nicknames) lives in Server and is only
+ * touched under Server::_stateLock; see Server::handleCommand.
+ *
+ * Flood control: every client has a token bucket (see hasFloodCredit).
+ * Lines that arrive while it is empty stay in the client's input buffer
+ * and are run once it refills; wait() is bounded so that happens on time.
+ *
+ * Timers: every client has one timer on the reactor's TimerWheel, for
+ * its registration deadline and then PING keepalive (see clientTimerFired).
+ *
+ * Reads: a readable client is read until its socket is drained or it used
+ * --read-budget bytes of this iteration (see handleClientRead).
+ *
+ * Send queues: every line queued for a client counts against its class
+ * limit (--sendq, --sendq-unregistered) and this reactor's share of
+ * --sendq-total (see admitOutput). A client over a limit gets nothing
+ * more and is disconnected before the next flush.
+ */
+class Reactor {
+  friend struct ServerBench; // bench/ delivers across reactors without threads
+
+public:
+  Reactor(Server *server, int id);
+  ~Reactor();
+
+  void initSocket();
+  void mainLoop();
+  void start();
+  void join();
+  void wake();
+
+  int getId() const;
+  bool isCurrent() const;
+  void reserveClients(size_t count);
+  void reportPools(std::vector<std::string> &lines) const;
+
+  /* =============================
+   *      CLIENT OUTPUT ROUTING
+   * ============================= */
+
+  /* A client of a posted batch; the id guards against fd reuse */
+  struct Recipient {
+    int fd;
+    unsigned long clientId;
+  };
+
+  void post(int fd, unsigned long clientId, const SharedLine &line);
+  void postBatch(const SharedLine &line, std::vector<Recipient> &to);
+  void markPendingSend(int fd);
+  bool admitOutput(const Client *c, size_t bytes);
+  void releaseOutput(size_t bytes);
+  void exceedSendq(Client *c);
+  size_t getQueuedBytes() const;
+  void releaseClient(int fd);
+
+private:
+  /* Bytes a read may take beyond the client's input buffer */
+  static const size_t READ_SCRATCH = 65536;
+
+  /**
+   * @brief A message queued by another thread for one of our clients.
+   * The client id guards against the fd being reused in the meantime.
+   */
+  struct Delivery {
+    int fd;
+    unsigned long clientId;
+    SharedLine line;
+  };
+
+  /* One line for many of our clients: a channel broadcast */
+  struct Batch {
+    SharedLine line;
+    std::vector<Recipient> to;
+  };
+
+  Server *_server;
+  int _id;
+  EventLoop *_loop;
+  int _listenFd;
+  int _wakeFd; // eventfd used by other threads to interrupt wait()
+  MetricsEndpoint *_metricsEndpoint; // reactor 0 only, if configured
+  bool _acceptPending; // accept budget ran out before the queue was empty
+  std::thread _thread;
+
+  FdTable<Client> _clients;         // clients owned by this reactor
+  std::vector<IoEvent> _events;     // ready fds of the current iteration
+  std::vector<int> _pendingSend;    // fds whose output queue became non-empty
+  std::vector<int> _throttled;      // fds with input deferred by flood control
+  std::vector<int> _readPending;    // fds whose read budget ran out
+  std::vector<int> _sendqExceeded;  // fds over a send queue limit
+  std::vector<int> _resuming;       // swapped with one of the above while resuming
+  std::vector<iovec> _iov;          // IOV_MAX scratch entries for sendmsg()
+  std::vector<char> _readScratch;   // overflow of reads past the input buffer
+  size_t _queuedBytes;  // output queued for our clients
+  size_t _sendqShare;   // --sendq-total / reactors, 0 = no global limit
+  std::atomic<size_t> _queuedBytesSeen; // _queuedBytes as of the last
+                                        // flush, for other threads
+
+  ObjectPool<Client> _clientPool;          // every Client this reactor owns
+  InputBuffer::BlockPool _bufferPool;      // their input buffer storage
+
+  std::mutex _inboxMutex;
+  std::vector<Delivery> _inbox;
+  std::vector<Delivery> _draining; // swapped with _inbox outside the lock
+  std::vector<Batch> _batches;     // broadcasts, under _inboxMutex too
+  std::vector<Batch> _drainingBatches;
+
+  uint64_t _now;        // monotonicNs() at the last wakeup
+  uint64_t _floodStep;  // ns of bucket time per token, 0 = no flood control
+  uint64_t _floodBurst; // ns a client's bucket clock may run ahead of _now
+  TimerWheel _timers;   // one timer per client, 1 s ticks
+
+  Rcu::Reader _rcuReader; // offline only while blocked in wait()
+
+  static thread_local Reactor *_current;
+
+  /* =============================
+   *       POLL MANAGEMENT
+   * ============================= */
+  void addPollFd(int fd);
+  void removePollFd(int fd);
+  void flushPendingWrites();
+  void drainInbox();
+  int nextTimeout() const;
+
+  /* =============================
+   *         FLOOD CONTROL
+   * ============================= */
+  bool hasFloodCredit(const Client *c) const;
+  void chargeFlood(Client *c, unsigned cost);
+  void throttle(Client *c);
+  void resumeThrottled();
+
+  /* =============================
+   *            TIMERS
+   * ============================= */
+  void startClientTimer(Client *c);
+  void expireTimers();
+  void clientTimerFired(Client *c);
+  void noteActivity(Client *c);
+
+  /* =============================
+   *     CLIENT CONNECTION OPS
+   * ============================= */
+  void applyListenerOptions();
+  void acceptNewClient();
+  void adoptClient(int clientFd);
+  bool handleClientRead(Client *c, bool hangup);
+  bool handleClientData(Client *c, const char *data, size_t length);
+  bool feedInput(Client *c, const char *data, size_t length,
+                 uint64_t receivedAt);
+  void deferRead(Client *c);
+  void resumeReads();
+  bool processInput(Client *c, uint64_t receivedAt);
+  void handleClientWrite(Client *client);
+  void dropSendqExceeded();
+  void rejectClient(Client *c, const std::string &reason);
+  void dropClient(int fd);
+
+  Reactor(const Reactor &);
+  Reactor &operator=(const Reactor &);
+};
+
+#endif
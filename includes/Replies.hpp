@@ -13,102 +13,162 @@
 #ifndef REPLIES_HPP
 #define REPLIES_HPP
 
+#include "ReplyFormat.hpp"
+
 #include <string>
 
 /*
  * In IRC protocol, the * symbol is used when the client does not yet have a
  * nickname, or when the numeric reply cannot logically address the user by
  * name.
+ *
+ * Every reply is a ReplyTemplate: "{}" marks an argument slot. Send one with
+ *   server->sendReply(fd, makeReply(ERR_NOSUCHNICK, nick));
+ * The argument count is checked at compile time.
  */
 
+#define IRC_SERVER_NAME "ircserver"
+
+/* ":ircserver <code> <text>\r\n" */
+#define IRC_NUMERIC(code, text)                                                \
+  ReplyTemplate<countReplySlots(text)>(":" IRC_SERVER_NAME " " code " " text  \
+                                       "\r\n")
+
+/* A line relayed on behalf of a client: "<text>\r\n" */
+#define IRC_MESSAGE(text) ReplyTemplate<countReplySlots(text)>(text "\r\n")
+
+/* Source prefix of relayed lines; slots: nick, user */
+#define IRC_USER_PREFIX ":{}!{}@localhost"
+
 /* ============================= */
 /*        ERROR NUMERICS         */
 /* ============================= */
 
-#define ERR_NEEDMOREPARAMS(cmd)                                                \
-  (std::string(":ircserver 461 ") + (cmd) + " :Not enough parameters\r\n")
-
-#define ERR_ALREADYREGISTRED(nick)                                             \
-  (std::string(":ircserver 462 ") + (nick) + " :You may not reregister\r\n")
-
-#define ERR_NICKNAMEINUSE(nick)                                                \
-  (std::string(":ircserver 433 * ") + (nick) +                                 \
-   " :Nickname is already in use\r\n")
-
-#define ERR_NONICKNAMEGIVEN                                                    \
-  (std::string(":ircserver 431 * :No nickname given\r\n"))
-
-#define ERR_NOSUCHNICK(nick)                                                   \
-  (std::string(":ircserver 401 * ") + (nick) + " :No such nick\r\n")
-  
-#define ERR_NOTREGISTERED                                                      \
-  (std::string(":ircserver 451 * :You have not registered\r\n"))
-  
-  /* ============================= */
-  /*    CHANNEL ERROR NUMERICS     */
-  /* ============================= */
-  
-#define ERR_NOSUCHCHANNEL(chan)                                                \
-  (std::string(":ircserver 403 * ") + (chan) + " :No such channel\r\n")
-
-#define ERR_NOTONCHANNEL(chan)                                                 \
-  (std::string(":ircserver 442 * ") + (chan) + " :You're not on that channel\r\n")
-  
-#define ERR_CANNOTSENDTOCHAN(chan)                                             \
-  (std::string(":ircserver 404 * ") + (chan) + " :Cannot send to channel\r\n")
-  
-#define ERR_CHANNELISFULL(chan)                                                \
-  (std::string(":ircserver 471 * ") + (chan) + " :Cannot join channel (+l)\r\n")
-
-#define ERR_INVITEONLYCHAN(chan)                                              \
-  (std::string(":ircserver 473 * ") + (chan) + " :Cannot join channel (+i)\r\n")
-
-#define ERR_BADCHANNELKEY(chan)                                               \
-  (std::string(":ircserver 475 * ") + (chan) + " :Cannot join channel (+k)\r\n")
-
-#define ERR_CHANOPRIVSNEEDED(chan)                                            \
-  (std::string(":ircserver 482 * ") + (chan) + " :You're not channel operator\r\n")
+inline constexpr auto ERR_NEEDMOREPARAMS =
+    IRC_NUMERIC("461", "{} :Not enough parameters");
+
+inline constexpr auto ERR_ALREADYREGISTRED =
+    IRC_NUMERIC("462", "{} :You may not reregister");
+
+inline constexpr auto ERR_PASSWDMISMATCH =
+    IRC_NUMERIC("464", "* :Password incorrect");
+
+inline constexpr auto ERR_NICKNAMEINUSE =
+    IRC_NUMERIC("433", "* {} :Nickname is already in use");
+
+inline constexpr auto ERR_NONICKNAMEGIVEN =
+    IRC_NUMERIC("431", "* :No nickname given");
+
+inline constexpr auto ERR_ERRONEUSNICKNAME =
+    IRC_NUMERIC("432", "* {} :Erroneous nickname");
+
+inline constexpr auto ERR_NOSUCHNICK = IRC_NUMERIC("401", "* {} :No such nick");
+
+inline constexpr auto ERR_NOPRIVILEGES = IRC_NUMERIC(
+    "481", "{} :Permission Denied- You're not an IRC operator");
+
+inline constexpr auto ERR_NOOPERHOST =
+    IRC_NUMERIC("491", "{} :No O-lines for your host");
+
+inline constexpr auto ERR_NOTREGISTERED =
+    IRC_NUMERIC("451", "* :You have not registered");
+
+inline constexpr auto ERR_NORECIPIENT =
+    IRC_NUMERIC("411", ":No recipient given (PRIVMSG)");
+
+inline constexpr auto ERR_NOTEXTTOSEND = IRC_NUMERIC("412", ":No text to send");
+
+/* ============================= */
+/*    CHANNEL ERROR NUMERICS     */
+/* ============================= */
+
+inline constexpr auto ERR_NOSUCHCHANNEL =
+    IRC_NUMERIC("403", "* {} :No such channel");
+
+inline constexpr auto ERR_USERNOTINCHANNEL =
+    IRC_NUMERIC("441", "* {} {} :They aren't on that channel");
+
+inline constexpr auto ERR_NOTONCHANNEL =
+    IRC_NUMERIC("442", "* {} :You're not on that channel");
+
+inline constexpr auto ERR_CANNOTSENDTOCHAN =
+    IRC_NUMERIC("404", "* {} :Cannot send to channel");
+
+inline constexpr auto ERR_CHANNELISFULL =
+    IRC_NUMERIC("471", "* {} :Cannot join channel (+l)");
+
+inline constexpr auto ERR_INVITEONLYCHAN =
+    IRC_NUMERIC("473", "* {} :Cannot join channel (+i)");
+
+inline constexpr auto ERR_BADCHANNELKEY =
+    IRC_NUMERIC("475", "* {} :Cannot join channel (+k)");
+
+inline constexpr auto ERR_CHANOPRIVSNEEDED =
+    IRC_NUMERIC("482", "* {} :You're not channel operator");
+
+inline constexpr auto ERR_TOPICTOOLONG = IRC_NUMERIC(
+    "422", "{} {} :Topic is too long (maximum 300 characters)");
 
 /* ============================= */
 /*      REGISTRATION NUMERICS    */
 /* ============================= */
 
-#define RPL_WELCOME(nick)                                                      \
-  (std::string(":ircserver 001 ") + (nick) + " :Welcome to the IRC server!\r\n")
+inline constexpr auto RPL_WELCOME =
+    IRC_NUMERIC("001", "{} :Welcome to the IRC server!");
 
-#define RPL_NAMREPLY(nick, chan, names)                                        \
-  (std::string(":ircserver 353 ") + (nick) + " = " + (chan) + " :" + (names) + \
-   "\r\n")
+inline constexpr auto RPL_ISUPPORT =
+    IRC_NUMERIC("005", "{} {} :are supported by this server");
 
-#define RPL_ENDOFNAMES(nick, chan)                                             \
-  (std::string(":ircserver 366 ") + (nick) + " " + (chan) +                    \
-   " :End of NAMES list\r\n")
+/* 353 without its names and CRLF: followed by a NamesCache payload line */
+inline constexpr auto RPL_NAMREPLY_HEAD =
+    ReplyTemplate<countReplySlots("{} = {} :")>(":" IRC_SERVER_NAME
+                                                " 353 {} = {} :");
+
+inline constexpr auto RPL_ENDOFNAMES =
+    IRC_NUMERIC("366", "{} {} :End of NAMES list");
 
 /* ============================= */
 /*      CHANNEL NUMERICS         */
 /* ============================= */
 
-#define RPL_INVITING(target, chan)                                            \
-  (std::string(":ircserver 341 ") + (target) + " " + (chan) + "\r\n")
-#define RPL_NOTOPIC(nick, chan)                                               \
-  (std::string(":ircserver 331 ") + (nick) + " " + (chan) +                   \
-   " :No topic is set\r\n")
-#define RPL_TOPIC(nick, chan, topic)                                         \
-  (std::string(":ircserver 332 ") + (nick) + " " + (chan) + " :" + (topic) + "\r\n")
+inline constexpr auto RPL_INVITING = IRC_NUMERIC("341", "{} {}");
+inline constexpr auto RPL_NOTOPIC = IRC_NUMERIC("331", "{} {} :No topic is set");
+inline constexpr auto RPL_TOPIC = IRC_NUMERIC("332", "{} {} :{}");
 
 /* ============================= */
 /*      QUERY NUMERICS      */
 /* ============================= */
 
-#define RPL_CHANNELMODEIS(nick, chan, modes)                                  \
-  (std::string(":ircserver 324 ") + (nick) + " " + (chan) + " " + (modes) +  \
-   "\r\n")
-
-#define RPL_WHOISUSER(nick, user, host, real)                                   \
-  (std::string(":ircserver 311 ") + (nick) + " " + (user) + " " + (host) +    \
-   " * :" + (real) + "\r\n")
-#define RPL_WHOISCHANNELS(nick, chanList)                                     \
-  (std::string(":ircserver 319 ") + (nick) + " :" + (chanList) + "\r\n")
-#define RPL_ENDOFWHOIS(nick)                                               \
-  (std::string(":ircserver 318 ") + (nick) + " :End of WHOIS list\r\n")
+inline constexpr auto RPL_CHANNELMODEIS = IRC_NUMERIC("324", "{} {} {}");
+
+inline constexpr auto RPL_WHOISUSER = IRC_NUMERIC("311", "{} {} {} * :{}");
+inline constexpr auto RPL_WHOISCHANNELS = IRC_NUMERIC("319", "{} :{}");
+inline constexpr auto RPL_ENDOFWHOIS =
+    IRC_NUMERIC("318", "{} :End of WHOIS list");
+
+inline constexpr auto RPL_YOUREOPER =
+    IRC_NUMERIC("381", "{} :You are now an IRC operator");
+
+inline constexpr auto RPL_STATSDEBUG = IRC_NUMERIC("249", "{} {} :{}");
+inline constexpr auto RPL_ENDOFSTATS =
+    IRC_NUMERIC("219", "{} {} :End of STATS report");
+
+/* ============================= */
+/*       RELAYED MESSAGES        */
+/* ============================= */
+
+inline constexpr auto MSG_PRIVMSG =
+    IRC_MESSAGE(IRC_USER_PREFIX " PRIVMSG {} :{}");
+inline constexpr auto MSG_JOIN = IRC_MESSAGE(IRC_USER_PREFIX " JOIN {}");
+inline constexpr auto MSG_PART = IRC_MESSAGE(IRC_USER_PREFIX " PART {}");
+inline constexpr auto MSG_KICK = IRC_MESSAGE(IRC_USER_PREFIX " KICK {} {}");
+inline constexpr auto MSG_QUIT = IRC_MESSAGE(IRC_USER_PREFIX " QUIT :Quit");
+inline constexpr auto MSG_INVITE = IRC_MESSAGE(IRC_USER_PREFIX " INVITE {} {}");
+inline constexpr auto MSG_TOPIC = IRC_MESSAGE(IRC_USER_PREFIX " TOPIC {} :{}");
+inline constexpr auto MSG_MODE = IRC_MESSAGE(IRC_USER_PREFIX " MODE {} {}");
+inline constexpr auto MSG_MODE_ARG =
+    IRC_MESSAGE(IRC_USER_PREFIX " MODE {} {} {}");
+inline constexpr auto MSG_PONG = IRC_MESSAGE("PONG :{}");
+inline constexpr auto MSG_PING = IRC_MESSAGE("PING :" IRC_SERVER_NAME);
+
 #endif
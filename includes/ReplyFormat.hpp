@@ -0,0 +1,106 @@
+#ifndef REPLYFORMAT_HPP
+#define REPLYFORMAT_HPP
+
+#include "SharedLine.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Counts the "{}" argument slots of a reply template.
+ */
+constexpr size_t countReplySlots(std::string_view text) {
+  size_t slots = 0;
+  for (size_t i = 0; i + 1 < text.size(); ++i) {
+    if (text[i] == '{' && text[i + 1] == '}') {
+      ++slots;
+      ++i;
+    }
+  }
+  return slots;
+}
+
+/**
+ * @brief A reply line split at compile time into literal pieces around
+ * Slots "{}" argument slots.
+ *
+ * Steps:
+ *  - The constexpr constructor cuts the literal into Slots + 1 views
+ *  - fixedLength is the byte count of everything but the arguments, so
+ *    the exact output size is one addition per argument away
+ *
+ * Templates are declared with IRC_NUMERIC / IRC_MESSAGE (Replies.hpp),
+ * which derive Slots from the literal itself.
+ */
+template <size_t Slots> struct ReplyTemplate {
+  std::string_view pieces[Slots + 1];
+  size_t fixedLength;
+
+  constexpr explicit ReplyTemplate(std::string_view text)
+      : pieces(), fixedLength(0) {
+    size_t piece = 0;
+    size_t start = 0;
+    for (size_t i = 0; i + 1 < text.size(); ++i) {
+      if (text[i] == '{' && text[i + 1] == '}') {
+        pieces[piece++] = text.substr(start, i - start);
+        start = i + 2;
+        ++i;
+      }
+    }
+    pieces[piece] = text.substr(start);
+    for (size_t i = 0; i <= Slots; ++i)
+      fixedLength += pieces[i].size();
+  }
+};
+
+/**
+ * @brief Appends a filled-in template to out with at most one reserve().
+ *
+ * Arguments may be anything convertible to std::string_view; their count
+ * is checked against the template at compile time.
+ */
+template <size_t Slots, typename... Args>
+void appendReply(std::string &out, const ReplyTemplate<Slots> &tpl,
+                 const Args &...args) {
+  static_assert(sizeof...(Args) == Slots,
+                "argument count does not match the reply template");
+  const std::string_view values[Slots + 1] = {std::string_view(args)...};
+
+  size_t length = tpl.fixedLength;
+  for (size_t i = 0; i < Slots; ++i)
+    length += values[i].size();
+  out.reserve(out.size() + length);
+
+  out.append(tpl.pieces[0]);
+  for (size_t i = 0; i < Slots; ++i) {
+    out.append(values[i]);
+    out.append(tpl.pieces[i + 1]);
+  }
+}
+
+/**
+ * @brief Formats a template into a new string sized exactly once.
+ */
+template <size_t Slots, typename... Args>
+std::string formatReply(const ReplyTemplate<Slots> &tpl, const Args &...args) {
+  std::string out;
+  appendReply(out, tpl, args...);
+  return out;
+}
+
+/**
+ * @brief Formats a template straight into a shareable output line.
+ *
+ * The bytes are written once, into the string that output queues will
+ * reference: one allocation for the shared string, one for its bytes.
+ */
+template <size_t Slots, typename... Args>
+SharedLine makeReply(const ReplyTemplate<Slots> &tpl, const Args &...args) {
+  std::shared_ptr<std::string> line = std::make_shared<std::string>();
+  appendReply(*line, tpl, args...);
+  return line;
+}
+
+#endif
@@ -23,29 +23,45 @@
 #include <poll.h>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <string_view>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <vector>
+#include <atomic>
+#include <shared_mutex>
+
+#include "Channel.hpp"
+#include "FdTable.hpp"
+#include "ObjectPool.hpp"
+#include "RcuMap.hpp"
+#include "ServerConfig.hpp"
 
 class Client;
+class Reactor;
 class Channel;
 struct ParsedCommand;
+struct CommandDescriptor;
 class CommandHandler;
 
 /**
- * @brief The central server class handling socket setup, polling,
- *        client connections, and dispatching IRC commands.
+ * @brief The central server class owning the shared IRC state and
+ *        dispatching IRC commands.
  *
  * Steps:
- *  - Initialize and configure the listening socket
- *  - Use poll() to monitor all file descriptors
- *  - Accept new clients and manage their lifetime
- *  - Read incoming data and extract IRC messages
- *  - Dispatch parsed IRC commands to CommandHandler
+ *  - Start one Reactor per configured thread; each reactor owns a
+ *    SO_REUSEPORT listener, an EventLoop and its clients' sockets
+ *  - Keep the shared state (client directory, channels, nicknames)
+ *  - Extract IRC messages and dispatch them to CommandHandler under
+ *    _stateLock: shared for read-only commands such as WHOIS, exclusive
+ *    for commands that change channels or nicknames, not at all for
+ *    PRIVMSG, which reads the RCU indexes (_nicks, _channelIndex) and
+ *    channel member views instead (see Rcu)
  */
 class Server {
 public:
-  Server(const std::string &port, const std::string &password);
+  Server(const std::string &port, const std::string &password,
+         const ServerConfig &config = ServerConfig());
   ~Server();
 
   void run();
@@ -63,48 +79,51 @@ public:
 private:
   friend class CommandHandler; // allow CommandHandler to access private
                                // internals
+  friend class Reactor;        // reactors feed reads into the dispatcher
+  friend struct ServerBench;   // bench/ drives the internals directly
+  friend class MetricsEndpoint; // renders the metrics on scrape
 
   /* =============================
    *        DATA MEMBERS
    * ============================= */
   std::string _port;
   std::string _password;
-  int _listenFd;
-  static bool _signal; // Signal checker
-
-  std::vector<pollfd> _pollfds;
-  std::map<int, Client *> _clients;
+  ServerConfig _config;
+  static std::atomic<bool> _signal; // Signal checker
+  static std::atomic<Reactor *> _signalTarget; // woken by signalHandler
+
+  std::vector<Reactor *> _reactors; // [0] runs on the main thread
+
+  // Everything below is shared between reactors and guarded by _stateLock;
+  // the RcuMaps are also read without it
+  mutable std::shared_mutex _stateLock;
+  unsigned long _nextClientId;
+  FdTable<Client> _clients;         // directory of all clients, by fd
+  RcuMap<Route> _nicks;             // casefolded nick index
+  // invited client id -> names of the channels that invited it
+  std::unordered_map<unsigned long, std::vector<std::string> > _invites;
   std::map<std::string, Channel *> _channels;
-
-  /* =============================
-   *      CORE SERVER LOGIC
-   * ============================= */
-  void initSocket();
-  void mainLoop();
-
-  /* =============================
-   *       POLL MANAGEMENT
-   * ============================= */
-  void addPollFd(int fd);
-  void removePollFd(int fd);
+  RcuMap<Channel *> _channelIndex; // same channels, for lock-free lookups
+  ObjectPool<Channel, 64> _channelPool;
 
   /* =============================
    *     CLIENT CONNECTION OPS
    * ============================= */
-  void acceptNewClient();
-  bool handleClientRead(int index);
+  void registerClient(Client *client);
   void removeClient(int fd);
 
   /* =============================
    *       MESSAGE PROCESSING
    * ============================= */
-  std::vector<std::string> extractMessages(Client *client);
-  void handleCommand(Client *client, const std::string &msg);
+  unsigned handleCommand(Client *client, std::string_view msg,
+                         uint64_t receivedAt = 0);
+  void dispatchCommand(Client *client, const CommandDescriptor &desc,
+                       const ParsedCommand &cmd);
 
   /* =============================
    *     REGISTRATION HELPERS
    * ============================= */
-  bool nicknameInUse(const std::string &nick) const;
+  void setClientNick(Client *client, const std::string &nick);
   bool isClientFullyRegistered(Client *client) const;
   void sendWelcome(Client *client);
   void tryRegister(Client *client);
@@ -115,11 +134,40 @@ private:
 
   Channel *getOrCreateChannel(const std::string &name);
   void cleanupChannel(std::string name);
-  Client *getClientByNick(const std::string &nick) const;
-  void removeInvitesForNick(const std::string &nick);
+  Client *getClientByNick(std::string_view nick) const;
+  const Route *findRoute(std::string_view nick) const;
+  void addInvite(Channel *channel, Client *client);
+  void removeInvitesFor(Client *client);
   void sendReply(int fd, const std::string &msg);
+  void sendReply(int fd, const SharedLine &line);
   void queueMessage(Client *client, const std::string &msg);
   void disconnectClientFromChannels(int fd);
+
+  /* ============================= */
+  /*           STATISTICS          */
+  /* ============================= */
+
+  void reportPools(std::vector<std::string> &lines) const;
+  void reportCommands(std::vector<std::string> &lines) const;
+  void reportLatency(std::vector<std::string> &lines) const;
+  void reportSendq(std::vector<std::string> &lines) const;
+  void refreshMetrics() const;
+  void renderMetrics(std::string &out) const;
+
+  /* Copy of the shared state the derived metrics are computed from */
+  struct SendqSample {
+    size_t peak;
+    size_t limit;
+    std::string name; // nick, or "fd<N>" before NICK
+  };
+  struct MetricsSnapshot {
+    std::vector<size_t> channelSizes;
+    std::vector<SendqSample> clients;
+    size_t queued;
+  };
+  void snapshotMetrics(MetricsSnapshot &snap) const;
+  static void applyMetrics(const MetricsSnapshot &snap);
+  static void renderSendqClients(MetricsSnapshot &snap, std::string &out);
 };
 
 #endif
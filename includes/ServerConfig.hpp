@@ -0,0 +1,46 @@
+#ifndef SERVERCONFIG_HPP
+#define SERVERCONFIG_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Startup options that are not part of the <port> <password> pair.
+ *
+ * Filled from "--name=value" flags in main() before the server is built.
+ */
+struct ServerConfig {
+  std::string eventBackend; // "epoll" (default), "uring" or "poll"
+  int threads;              // number of reactor threads (SO_REUSEPORT)
+  size_t reserveClients;    // Client pool slots allocated up front (total)
+  size_t reserveChannels;   // Channel pool slots allocated up front
+  int metricsPort;          // localhost Prometheus endpoint, 0 = disabled
+  unsigned floodRate;       // flood control tokens per second, 0 = disabled
+  unsigned floodBurst;      // tokens a client may spend at once
+  size_t floodQueue;        // deferred input bytes before "Excess Flood"
+  unsigned pingInterval;    // idle seconds before a server PING, 0 = never
+  unsigned pingTimeout;     // seconds to answer it before "Ping timeout"
+  unsigned registrationTimeout; // seconds to finish PASS/NICK/USER, 0 = none
+  int listenBacklog;        // listen() queue length per reactor
+  int deferAccept;          // TCP_DEFER_ACCEPT seconds, 0 = off
+  bool tcpNoDelay;          // TCP_NODELAY on accepted sockets
+  int sendBuffer;           // SO_SNDBUF bytes of accepted sockets, 0 = kernel
+  int recvBuffer;           // SO_RCVBUF bytes of accepted sockets, 0 = kernel
+  int acceptBudget;         // connections accepted per loop iteration
+  size_t readBudget;        // bytes read from one client per loop iteration
+  size_t sendQueue;         // output bytes queued per registered client
+  size_t sendQueueUnregistered; // same before registration completes
+  size_t sendQueueTotal;    // output bytes queued for all clients, 0 = any
+  bool logConnections;      // print a line per connect / disconnect
+  std::string operPassword; // OPER password, empty = no operators
+
+  ServerConfig();
+
+  /**
+   * @brief Applies one "--name=value" flag.
+   * @return false if the flag is unknown or its value is invalid.
+   */
+  bool applyFlag(const std::string &flag);
+};
+
+#endif
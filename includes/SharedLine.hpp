@@ -0,0 +1,26 @@
+#ifndef SHAREDLINE_HPP
+#define SHAREDLINE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+
+/**
+ * @brief An outgoing IRC line, serialized once and shared (refcounted,
+ * immutable) by every recipient it is queued for.
+ */
+typedef std::shared_ptr<const std::string> SharedLine;
+
+/**
+ * @brief One entry of a client's output queue: a shared line plus how many
+ * of its bytes this client has already sent.
+ */
+struct OutputChunk {
+  SharedLine line;
+  size_t offset;
+};
+
+typedef std::deque<OutputChunk> OutputQueue;
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * @brief Hierarchical timing wheel with intrusive timers.
+ *
+ * Steps:
+ *  - Time advances in ticks of tickNs; LEVELS wheels of SLOTS slots each
+ *    cover SLOTS, SLOTS^2, ... ticks ahead (4 x 64 slots: 2^24 ticks)
+ *  - schedule() drops a timer into the slot of the coarsest level that
+ *    still tells its tick apart; cancel() unlinks it. Both are O(1)
+ *  - advance() walks the elapsed ticks; whenever a level wraps, the
+ *    matching slot of the level above is cascaded into finer slots, so
+ *    every timer is moved at most LEVELS - 1 times over its lifetime
+ *  - Due timers are moved to an expired list and handed out one at a
+ *    time by nextExpired(), so a callback may cancel or destroy any other
+ *    timer, due or not
+ *
+ * Timers are embedded in their owner (see Client) and unlink themselves
+ * when destroyed. Not synchronized: one wheel per reactor thread.
+ */
+class TimerWheel {
+public:
+  static const int LEVELS = 4;
+  static const int SLOT_BITS = 6;
+  static const int SLOTS = 1 << SLOT_BITS;
+
+  class Timer {
+  public:
+    Timer() : data(NULL), _prev(NULL), _next(NULL), _expires(0) {}
+    ~Timer() { unlink(); }
+
+    bool pending() const { return _prev != NULL; }
+
+    void *data; // owner of the timer, for the expiry handler
+
+  private:
+    friend class TimerWheel;
+
+    Timer *_prev; // NULL when not scheduled
+    Timer *_next;
+    uint64_t _expires; // tick
+
+    void unlink();
+
+    Timer(const Timer &);
+    Timer &operator=(const Timer &);
+  };
+
+  TimerWheel(uint64_t tickNs, uint64_t nowNs);
+  ~TimerWheel();
+
+  void schedule(Timer &timer, uint64_t atNs);
+  void cancel(Timer &timer) { timer.unlink(); }
+
+  void advance(uint64_t nowNs);
+  Timer *nextExpired();
+  int timeoutMs(uint64_t nowNs) const;
+
+private:
+  uint64_t _tickNs;
+  uint64_t _originNs; // time of tick 0
+  uint64_t _current;  // last tick processed
+  Timer _slots[LEVELS][SLOTS]; // list heads (circular, self-linked)
+  Timer _expired;
+
+  void place(Timer &timer);
+  void cascade(int level);
+  void expireSlot(Timer &head);
+  bool idle() const;
+  static void append(Timer &head, Timer &timer);
+  static void detachAll(Timer &head);
+  static bool emptyList(const Timer &head) { return head._next == &head; }
+
+  TimerWheel(const TimerWheel &);
+  TimerWheel &operator=(const TimerWheel &);
+};
+
+#endif
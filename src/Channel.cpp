@@ -17,6 +17,9 @@
 
 #include "../includes/Channel.hpp"
 #include "../includes/Client.hpp"
+#include "../includes/Metrics.hpp"
+#include "../includes/Rcu.hpp"
+#include "../includes/Reactor.hpp"
 #include "../includes/Server.hpp"
 
 #include <algorithm>
@@ -27,18 +30,22 @@
 /* ============================= */
 
 Channel::Channel(const std::string &name)
-    : _name(name), _topicProtected(false),
-      _key(), _inviteOnly(false), _limit(0) {}
+    : _name(name), _names(name), _topicProtected(false),
+      _key(), _inviteOnly(false), _limit(0) {
+  _view.store(new MemberView(), std::memory_order_relaxed);
+}
 
-Channel::~Channel() {}
+/* Destroyed through rcu() (see Server::cleanupChannel): no reader is left */
+Channel::~Channel() { delete _view.load(std::memory_order_relaxed); }
 
 /* ============================= */
 /*           GETTERS             */
 /* ============================= */
 
 const std::string &Channel::getName() const { return _name; }
-const std::vector<Client *> &Channel::getClients() const { return _clients; }
-const std::vector<Client *> &Channel::getOperators() const { return _operators; }
+const std::vector<Client *> &Channel::getClients() const {
+  return _members.members();
+}
 
 bool Channel::isInviteOnly() const { return _inviteOnly; }
 
@@ -50,7 +57,7 @@ bool Channel::hasKey() const { return !_key.empty(); }
 
 bool Channel::hasLimit() const { return _limit > 0; }
 int Channel::getLimit() const { return _limit; }
-bool Channel::isFull() const { return hasLimit() && _clients.size() >= static_cast<size_t>(_limit); }
+bool Channel::isFull() const { return hasLimit() && _members.size() >= static_cast<size_t>(_limit); }
 
 // setters
 
@@ -66,76 +73,220 @@ void Channel::clearKey() { _key.clear(); }
 /*       MEMBER MANAGEMENT       */
 /* ============================= */
 
+/**
+ * @brief NAMES token of a member: its nick, "@"-prefixed for operators.
+ */
+static std::string namesToken(const std::string &nick, bool op) {
+  return op ? "@" + nick : nick;
+}
+
+static bool routeBefore(const Route &route, const Client *client) {
+  return route.client < client;
+}
+
+/**
+ * @brief Adds a member to the table, the NAMES cache and a new view.
+ * A view entry left at the same (pooled) address is replaced, as
+ * MemberTable does with its record.
+ */
 void Channel::addClient(Client *client) {
-  if (std::find(_clients.begin(), _clients.end(), client) == _clients.end())
-    _clients.push_back(client);
+  if (!_members.add(client))
+    return;
+  bool op = isOperator(client);
+  _members.setTag(client,
+                  _names.add(namesToken(client->getNickname(), op)));
+
+  const std::vector<Route> &routes =
+      _view.load(std::memory_order_relaxed)->routes;
+  MemberView *next = new MemberView();
+  next->routes.reserve(routes.size() + 1);
+  std::vector<Route>::const_iterator at =
+      std::lower_bound(routes.begin(), routes.end(), client, routeBefore);
+  next->routes.assign(routes.begin(), at);
+  next->routes.push_back(client->getRoute());
+  if (at != routes.end() && at->client == client)
+    ++at;
+  next->routes.insert(next->routes.end(), at, routes.end());
+  publishView(next);
 }
 
+/**
+ * @brief Membership from the table; needs Server::_stateLock.
+ */
 bool Channel::hasClient(Client *client) const {
-  const std::vector<Client *> &members = _clients;
-  return std::find(members.begin(), members.end(), client) != members.end();
+  return _members.contains(client);
+}
+
+/**
+ * @brief Membership from the published view: for lock-free readers,
+ * which may only ask about themselves (see handlePRIVMSG).
+ */
+bool Channel::hasMember(Client *client) const {
+  const std::vector<Route> &routes =
+      _view.load(std::memory_order_acquire)->routes;
+  std::vector<Route>::const_iterator it =
+      std::lower_bound(routes.begin(), routes.end(), client, routeBefore);
+  return it != routes.end() && it->client == client &&
+         it->clientId == client->getId();
 }
-/** 
- *  @brief Removes a client from the channel, including from operators and invited lists.
+
+/**
+ *  @brief Removes a client from the channel, including its operator status
+ *  and any pending invitation.
  */
 void Channel::removeClient(Client *client) {
-  std::vector<Client *>::iterator it =
-      std::find(_clients.begin(), _clients.end(), client);
+  if (!hasClient(client)) {
+    _members.remove(client);
+    return;
+  }
+  _names.remove(_members.tagOf(client),
+                namesToken(client->getNickname(), isOperator(client)));
+  _members.remove(client);
 
-  if (it != _clients.end())
-    _clients.erase(it);
+  const std::vector<Route> &routes =
+      _view.load(std::memory_order_relaxed)->routes;
+  MemberView *next = new MemberView();
+  next->routes.reserve(routes.size());
+  for (size_t i = 0; i < routes.size(); ++i) {
+    if (routes[i].client != client)
+      next->routes.push_back(routes[i]);
+  }
+  publishView(next);
+}
 
-  removeOperator(client);
-  removeInvited(client->getNickname());
+/**
+ * @brief Swaps in a new member view; the old one is freed once no
+ * lock-free reader can still be walking it. Writers only.
+ */
+void Channel::publishView(MemberView *next) {
+  const MemberView *old = _view.exchange(next, std::memory_order_acq_rel);
+  rcu().retire([old] { delete old; });
 }
 
-void Channel::inviteNickname(const std::string &nickname) {
-  if (std::find(_invited.begin(), _invited.end(), nickname) == _invited.end())
-    _invited.push_back(nickname);
+void Channel::inviteClient(Client *client) {
+  _members.setFlags(client, MemberTable::INVITED);
 }
 
-bool Channel::isInvited(const std::string &nickname) const {
-  return std::find(_invited.begin(), _invited.end(), nickname) != _invited.end();
+bool Channel::isInvited(Client *client) const {
+  return _members.hasFlags(client, MemberTable::INVITED);
 }
 
-void Channel::removeInvited(const std::string &nickname) {
-  std::vector<std::string>::iterator it =
-      std::find(_invited.begin(), _invited.end(), nickname);
-  if (it != _invited.end())
-    _invited.erase(it);
+void Channel::removeInvited(Client *client) {
+  _members.clearFlags(client, MemberTable::INVITED);
 }
 
-void Channel::clearInvites() { _invited.clear(); }
+void Channel::clearInvites() {
+  _members.clearFlagsEverywhere(MemberTable::INVITED);
+}
 
-void Channel::addOperator(Client *client) {
-  if (std::find(_operators.begin(), _operators.end(), client) ==
-      _operators.end()) {
-    _operators.push_back(client);
-  }
+/**
+ * @brief Makes a member an operator. Returns false for non-members.
+ */
+bool Channel::addOperator(Client *client) {
+  if (isOperator(client))
+    return true;
+  if (!_members.setFlags(client, MemberTable::OPERATOR))
+    return false;
+  const std::string &nick = client->getNickname();
+  _members.setTag(client, _names.replace(_members.tagOf(client),
+                                         namesToken(nick, false),
+                                         namesToken(nick, true)));
+  return true;
 }
 
 void Channel::removeOperator(Client *client) {
-  std::vector<Client *>::iterator it =
-      std::find(_operators.begin(), _operators.end(), client);
-
-  if (it != _operators.end())
-    _operators.erase(it);
+  if (!isOperator(client))
+    return;
+  _members.clearFlags(client, MemberTable::OPERATOR);
+  if (hasClient(client)) {
+    const std::string &nick = client->getNickname();
+    _members.setTag(client, _names.replace(_members.tagOf(client),
+                                           namesToken(nick, true),
+                                           namesToken(nick, false)));
+  }
 }
 
 bool Channel::isOperator(Client *client) const {
-  return std::find(_operators.begin(), _operators.end(), client) !=
-         _operators.end();
+  return _members.hasFlags(client, MemberTable::OPERATOR);
+}
+
+/**
+ * @brief Updates the NAMES entry of a member whose nick just changed.
+ */
+void Channel::renameMember(Client *client, const std::string &oldNick) {
+  if (!hasClient(client))
+    return;
+  bool op = isOperator(client);
+  _members.setTag(client, _names.replace(_members.tagOf(client),
+                                         namesToken(oldNick, op),
+                                         namesToken(client->getNickname(), op)));
+}
+
+/**
+ * @brief Appends the cached RPL_NAMREPLY payload lines (names + CRLF).
+ * Each needs a RPL_NAMREPLY_HEAD line queued in front of it.
+ */
+void Channel::collectNames(std::vector<SharedLine> &lines) {
+  _names.collect(lines);
 }
 
 /* ============================= */
 /*          BROADCASTING         */
 /* ============================= */
 
+/**
+ * @brief Sends a line to every member except exclude.
+ *
+ * The line is serialized once into a SharedLine; each member's queue only
+ * gets a reference to it. Members are taken from the published view, so
+ * this runs without the state lock too (PRIVMSG). Members owned by the
+ * calling reactor get the line directly; the others are grouped by owner
+ * and handed over as one batch per reactor (see Reactor::postBatch).
+ */
 void Channel::broadcast(const std::string &msg, Client *exclude) {
-  for (size_t i = 0; i < _clients.size(); i++) {
-    if (_clients[i] == exclude)
+  if (msg.empty())
+    return;
+  broadcast(std::make_shared<const std::string>(msg), exclude);
+}
+
+void Channel::broadcast(const SharedLine &line, Client *exclude) {
+  if (!line || line->empty())
+    return;
+  // Recipients per remote reactor, indexed by reactor id; kept across
+  // calls so their storage is reused
+  static thread_local std::vector<std::vector<Reactor::Recipient> > remote;
+  static thread_local std::vector<Reactor *> owners;
+
+  const std::vector<Route> &routes =
+      _view.load(std::memory_order_acquire)->routes;
+  for (size_t i = 0; i < routes.size(); i++) {
+    const Route &member = routes[i];
+    if (member.client == exclude)
       continue;
 
-    _clients[i]->queueMessage(msg);
+    Reactor *owner = member.owner;
+    if (!owner || owner->isCurrent()) {
+      member.client->queueMessage(line);
+      continue;
+    }
+    size_t id = static_cast<size_t>(owner->getId());
+    if (id >= remote.size()) {
+      remote.resize(id + 1);
+      owners.resize(id + 1, NULL);
+    }
+    owners[id] = owner;
+    Reactor::Recipient to;
+    to.fd = member.fd;
+    to.clientId = member.clientId;
+    remote[id].push_back(to);
+  }
+
+  for (size_t id = 0; id < remote.size(); ++id) {
+    if (remote[id].empty())
+      continue;
+    // Counted here, once per recipient, like queueMessage would; the
+    // owner's drainInbox appends without counting again
+    ServerMetrics::queuedLines += remote[id].size();
+    owners[id]->postBatch(line, remote[id]);
   }
 }
@@ -17,7 +17,10 @@
 
 #include "../includes/Client.hpp"
 #include "../includes/Channel.hpp"
+#include "../includes/Metrics.hpp"
+#include "../includes/Reactor.hpp"
 #include <algorithm>
+#include <iterator>
 
 /**
  * @brief Constructs a Client instance for the given socket fd.
@@ -25,7 +28,7 @@
  */
 
 Client::Client(int fd)
-    : _fd(fd), _nickname(""), _username(""), _realname(""), _authenticated(false), _hasValidPass(false), _buffer(""), _outputBufferSize(0), _outputBuffer() {}
+    : _fd(fd), _id(0), _owner(NULL), _nickname(""), _username(""), _realname(""), _authenticated(false), _hasValidPass(false), _oper(false), _floodClock(0), _throttled(false), _readPending(false), _timer(), _lastActivity(0), _awaitingPong(false), _input(), _outputBufferSize(0), _outputBuffer(), _sendqLimit(0), _sendqExceeded(false), _sendqPeak(0) {}
 /**
  * @brief Destructor. No special cleanup required here.
  * Channel removal and server-side cleanup is handled by Server.
@@ -37,15 +40,37 @@ Client::~Client() {}
 /* ============================= */
 
 int Client::getFd() const { return _fd; }
+unsigned long Client::getId() const { return _id; }
+Reactor *Client::getOwner() const { return _owner; }
 const std::string &Client::getNickname() const { return _nickname; }
 const std::string &Client::getUsername() const { return _username; }
 const std::string &Client::getRealname() const { return _realname; }
-const std::string &Client::getBuffer() const { return _buffer; }
 bool Client::isAuthenticated() const { return _authenticated; }
-std::string &Client::getBufferRef() { return _buffer; }
+InputBuffer &Client::getInput() { return _input; }
 bool Client::hasValidPass() const { return _hasValidPass; }
-std::deque<std::string> Client::getoutputBuffer() const { return _outputBuffer; }
-int Client::getOutputBufferSize() const { return _outputBufferSize; }
+bool Client::isOper() const { return _oper; }
+const OutputQueue &Client::getoutputBuffer() const { return _outputBuffer; }
+size_t Client::getOutputBufferSize() const { return _outputBufferSize; }
+size_t Client::getSendqLimit() const { return _sendqLimit; }
+size_t Client::getSendqPeak() const {
+  return _sendqPeak.load(std::memory_order_relaxed);
+}
+bool Client::isSendqExceeded() const { return _sendqExceeded; }
+uint64_t Client::getFloodClock() const { return _floodClock; }
+bool Client::isThrottled() const { return _throttled; }
+bool Client::isReadPending() const { return _readPending; }
+TimerWheel::Timer &Client::getTimer() { return _timer; }
+uint64_t Client::getLastActivity() const { return _lastActivity; }
+bool Client::isAwaitingPong() const { return _awaitingPong; }
+
+Route Client::getRoute() {
+  Route route;
+  route.client = this;
+  route.owner = _owner;
+  route.fd = _fd;
+  route.clientId = _id;
+  return route;
+}
 
 /* ============================= */
 /*           SETTERS             */
@@ -56,30 +81,109 @@ void Client::setUsername(const std::string &user) { _username = user; }
 void Client::setRealname(const std::string &real) { _realname = real; }
 void Client::setAuthenticated(bool status) { _authenticated = status; }
 void Client::setValidPass(bool status) { _hasValidPass = status; }
+void Client::setOper(bool status) { _oper = status; }
+void Client::setId(unsigned long id) { _id = id; }
+void Client::setOwner(Reactor *owner) { _owner = owner; }
+void Client::setFloodClock(uint64_t ns) { _floodClock = ns; }
+void Client::setThrottled(bool status) { _throttled = status; }
+void Client::setReadPending(bool status) { _readPending = status; }
+void Client::setLastActivity(uint64_t ns) { _lastActivity = ns; }
+void Client::setAwaitingPong(bool status) { _awaitingPong = status; }
+void Client::setSendqLimit(size_t bytes) { _sendqLimit = bytes; }
+void Client::setSendqExceeded(bool status) { _sendqExceeded = status; }
 
 /* ============================= */
 /*         BUFFER HANDLING       */
 /* ============================= */
 
 /**
- * @brief Appends raw incoming data to the client's buffer.
- * Used to accumulate partial TCP fragments until a full IRC command is formed.
+ * @brief Queues a message to be sent to the client.
+ * Wraps the text in a SharedLine; use the SharedLine overload directly
+ * when the same line goes to several clients.
  */
-void Client::appendToBuffer(const std::string &data) { _buffer += data; }
+void Client::queueMessage(const std::string &data) {
+  if (data.empty())
+    return;
+  queueMessage(std::make_shared<const std::string>(data));
+}
 
 /**
- * @brief Clears the buffer once all complete IRC commands have been processed.
+ * @brief Queues a reference to a shared line.
+ *
+ * Steps:
+ *  - Count the line once, on the thread that produced it
+ *  - From another reactor's thread: hand the line to the owner's inbox
+ *  - Otherwise append it (see enqueue)
  */
-void Client::clearBuffer() { _buffer.clear(); }
+void Client::queueMessage(const SharedLine &line) {
+  if (!line || line->empty())
+    return;
+  ++ServerMetrics::queuedLines;
+  if (_owner && !_owner->isCurrent()) {
+    _owner->post(_fd, _id, line);
+    return;
+  }
+  enqueue(line);
+}
 
 /**
- * @brief Queues a message to be sent to the client.
+ * @brief Appends a line on the owner's thread without counting it.
+ * Used by queueMessage and by Reactor::drainInbox, whose lines were
+ * already counted where they were posted.
+ *
+ * Steps:
+ *  - Nothing more is queued to a client marked for disconnection
+ *  - A line that would take the queue past the client's limit, or that
+ *    the owner does not admit against its total, is dropped and the
+ *    client marked (see Reactor::exceedSendq); what is already queued
+ *    stays intact
+ *  - Otherwise append it, telling the owner when the queue stops being
+ *    empty so write interest gets armed
  */
-void Client::queueMessage(const std::string &data) {
-  if (data.empty())
+void Client::enqueue(const SharedLine &line) {
+  if (!line || line->empty())
     return;
-  _outputBuffer.push_back(data);
-  _outputBufferSize += data.size();
+  if (_owner) {
+    if (_sendqExceeded)
+      return;
+    if (_outputBufferSize + line->size() > _sendqLimit ||
+        !_owner->admitOutput(this, line->size())) {
+      _owner->exceedSendq(this);
+      return;
+    }
+  }
+  if (_outputBuffer.empty() && _owner)
+    _owner->markPendingSend(_fd);
+  OutputChunk chunk;
+  chunk.line = line;
+  chunk.offset = 0;
+  _outputBuffer.push_back(chunk);
+  _outputBufferSize += line->size();
+}
+
+/**
+ * @brief Queues a line for the routed client from any thread, without the
+ * state lock: the owner's thread (or a bench without reactors) queues it
+ * directly, any other thread counts it and posts it to the owner's inbox.
+ */
+void Route::deliver(const SharedLine &line) const {
+  if (!owner || owner->isCurrent()) {
+    client->queueMessage(line);
+    return;
+  }
+  ++ServerMetrics::queuedLines;
+  owner->post(fd, clientId, line);
+}
+
+/**
+ * @brief Raises the send queue high-water mark to the current size.
+ * Called by the owner right before each flush: the queue only grows
+ * between flushes, so that is where it peaks. Single writer, so a relaxed
+ * load and store are enough.
+ */
+void Client::updateSendqPeak() {
+  if (_outputBufferSize > _sendqPeak.load(std::memory_order_relaxed))
+    _sendqPeak.store(_outputBufferSize, std::memory_order_relaxed);
 }
 /**
  * @brief Checks if there are pending messages to send.
@@ -90,47 +194,60 @@ bool Client::hasPendingSend() const { return !_outputBuffer.empty(); }
  * @brief Clears all queued messages in the output buffer.
  */
 void Client::clearOutputBuffer() {
+  if (_owner)
+    _owner->releaseOutput(_outputBufferSize);
   _outputBuffer.clear();
   _outputBufferSize = 0;
 }
 
 /**
- * @brief Peeks at the next message to be sent without removing it.
- * @return The next message in the output buffer, or an empty string if none.
+ * @brief Describes the unsent part of the queue as an iovec array.
+ * @param iov Output array, filled front to back.
+ * @param maxIov Capacity of iov (IOV_MAX for writev / sendmsg).
+ * @return Number of iovecs filled; each points into a shared line, which
+ * stays alive until consumeBytes() pops it.
  */
-std::string Client::peekOutputBuffer() const {
-  if (_outputBuffer.empty())
-    return "";
-  return _outputBuffer.front();
+size_t Client::fillIovec(struct iovec *iov, size_t maxIov) const {
+  size_t count = 0;
+
+  for (OutputQueue::const_iterator it = _outputBuffer.begin();
+       it != _outputBuffer.end() && count < maxIov; ++it, ++count) {
+    iov[count].iov_base = const_cast<char *>(it->line->data() + it->offset);
+    iov[count].iov_len = it->line->size() - it->offset;
+  }
+  return count;
 }
-/**
- * @brief Peeks at the message at a specific offset in the output buffer.
- * @param offset The offset index to peek at.
- */
 
 /**
- * @brief updates the total size of the output buffer and removes bytes that have been sent.
+ * @brief updates the total size of the output buffer and marks bytes as sent.
  * @param bytes Number of bytes to consume from the output buffer.
  * -steps:
  * - Iterate through the output buffer deque
- * - Remove bytes from the front strings until the requested number is consumed
- * - Adjust the total output buffer size accordingly
+ * - Pop lines that are fully sent (dropping this client's reference)
+ * - For a partially sent line, only advance its offset; the shared
+ *   bytes are never modified
+ * - Adjust the total output buffer size accordingly, and the owner's
+ *   total of queued bytes by as much
  */
 void Client::consumeBytes(size_t bytes) {
   size_t localBytes = bytes;
+  size_t before = _outputBufferSize;
 
   while (localBytes > 0 && !_outputBuffer.empty()) {
-    std::string &front = _outputBuffer.front();
-    if (front.size() <= localBytes) {
-      localBytes -= front.size();
-      _outputBufferSize -= front.size();
+    OutputChunk &front = _outputBuffer.front();
+    size_t remaining = front.line->size() - front.offset;
+    if (remaining <= localBytes) {
+      localBytes -= remaining;
+      _outputBufferSize -= remaining;
       _outputBuffer.pop_front();
     } else {
-      front.erase(0, localBytes);
+      front.offset += localBytes;
       _outputBufferSize -= localBytes;
       localBytes = 0;
     }
   }
+  if (_owner)
+    _owner->releaseOutput(before - _outputBufferSize);
 }
 
 /* ============================= */
@@ -149,11 +266,12 @@ void Client::joinChannel(Channel *channel) {
  * @brief Removes the client from a channel if they are a member.
  */
 void Client::leaveChannel(Channel *channel) {
-  std::vector<Channel *>::iterator it =
-      std::find(_joined.begin(), _joined.end(), channel);
+  // searched from the back: teardown leaves channels in reverse join order
+  std::vector<Channel *>::reverse_iterator it =
+      std::find(_joined.rbegin(), _joined.rend(), channel);
 
-  if (it != _joined.end())
-    _joined.erase(it);
+  if (it != _joined.rend())
+    _joined.erase(std::next(it).base());
 }
 
 /**
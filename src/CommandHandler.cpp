@@ -18,7 +18,9 @@
 
 #include "../includes/CommandHandler.hpp"
 #include "../includes/CommandHandlerHelpers.hpp"
+#include "../includes/Casemap.hpp"
 #include "../includes/Channel.hpp"
+#include "../includes/Metrics.hpp"
 #include "../includes/Replies.hpp"
 #include "../includes/Server.hpp"
 
@@ -31,24 +33,17 @@
 
 void CommandHandler::handlePASS(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  // No password argument
-  if (cmd.params.empty()) {
-    server->sendReply(client->getFd(), ERR_NEEDMOREPARAMS("PASS"));
-    return;
-  }
-
   if (client->isAuthenticated()) {
     server->sendReply(client->getFd(),
-                      ERR_ALREADYREGISTRED(client->getNickname()));
+                      makeReply(ERR_ALREADYREGISTRED, client->getNickname()));
     return;
   }
 
-  const std::string &pass = cmd.params[0];
+  std::string pass(cmd.params[0]);
 
   // Wrong password
   if (pass != server->getPassword()) {
-    server->sendReply(client->getFd(),
-                      ":ircserver 464 * :Password incorrect\r\n");
+    server->sendReply(client->getFd(), makeReply(ERR_PASSWDMISMATCH));
     return;
   }
 
@@ -63,18 +58,24 @@ void CommandHandler::handlePASS(Server *server, Client *client,
 void CommandHandler::handleNICK(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
   if (cmd.params.empty()) {
-    server->sendReply(client->getFd(), ERR_NONICKNAMEGIVEN);
+    server->sendReply(client->getFd(), makeReply(ERR_NONICKNAMEGIVEN));
     return;
   }
 
-  const std::string &nick = cmd.params[0];
+  std::string nick(cmd.params[0]);
+  if (nick.size() > SERVER_NICKLEN) {
+    server->sendReply(client->getFd(), makeReply(ERR_ERRONEUSNICKNAME, nick));
+    return;
+  }
 
-  if (server->nicknameInUse(nick)) {
-    server->sendReply(client->getFd(), ERR_NICKNAMEINUSE(nick));
+  // Changing only the case of one's own nick is not a collision
+  Client *holder = server->getClientByNick(nick);
+  if (holder && holder != client) {
+    server->sendReply(client->getFd(), makeReply(ERR_NICKNAMEINUSE, nick));
     return;
   }
 
-  client->setNickname(nick);
+  server->setClientNick(client, nick);
   server->tryRegister(client);
 }
 
@@ -84,19 +85,19 @@ void CommandHandler::handleNICK(Server *server, Client *client,
 
 void CommandHandler::handleUSER(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  if (cmd.params.size() < 3 || cmd.trailing.empty()) {
-    server->sendReply(client->getFd(), ERR_NEEDMOREPARAMS("USER"));
+  if (cmd.trailing.empty()) { // the three middles are checked on dispatch
+    server->sendReply(client->getFd(), makeReply(ERR_NEEDMOREPARAMS, "USER"));
     return;
   }
 
   if (client->isAuthenticated()) {
     server->sendReply(client->getFd(),
-                      ERR_ALREADYREGISTRED(client->getNickname()));
+                      makeReply(ERR_ALREADYREGISTRED, client->getNickname()));
     return;
   }
 
-  client->setUsername(cmd.params[0]);
-  client->setRealname(cmd.trailing);
+  client->setUsername(std::string(cmd.params[0]));
+  client->setRealname(std::string(cmd.trailing));
 
   server->tryRegister(client);
 }
@@ -113,18 +114,15 @@ void CommandHandler::handleQUIT(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
   (void)cmd;
 
-  std::string quitMsg = ":" + client->getNickname() + "!" +
-                        client->getUsername() + "@localhost QUIT :Quit\r\n";
+  // serialized once, shared by every channel the client was in
+  SharedLine quitMsg =
+      makeReply(MSG_QUIT, client->getNickname(), client->getUsername());
 
   const std::vector<Channel *> &joined = client->getJoinedChannels();
 
-  // Broadcast QUIT and remove client from all channels
-  for (size_t i = 0; i < joined.size(); i++) {
-    Channel *ch = joined[i];
-    ch->broadcast(quitMsg, client);
-    ch->removeClient(client);
-    server->cleanupChannel(ch->getName());
-  }
+  // Broadcast QUIT; removeClient() then leaves (and cleans up) the channels
+  for (size_t i = 0; i < joined.size(); i++)
+    joined[i]->broadcast(quitMsg, client);
   server->removeClient(client->getFd());
 }
 
@@ -140,58 +138,56 @@ void CommandHandler::handleQUIT(Server *server, Client *client,
  *  - If target is channel (#), send to all members except sender
  *  - Otherwise, treat as nickname and send directly to user
  *  - Use numeric replies instead of disconnecting on error
+ *
+ * Runs without the state lock (LOCK_NONE): the channel and the receiver
+ * come from the RCU indexes, membership and recipients from the channel's
+ * member view, and replies go straight to the sender's queue.
  */
 void CommandHandler::handlePRIVMSG(Server *server, Client *client,
                                    const ParsedCommand &cmd) {
   // No target given
   if (cmd.params.empty()) {
-    server->sendReply(client->getFd(),
-                      ":ircserver 411 :No recipient given (PRIVMSG)\r\n");
+    client->queueMessage(makeReply(ERR_NORECIPIENT));
     return;
   }
 
   // No text to send
   if (cmd.trailing.empty()) {
-    server->sendReply(client->getFd(), ":ircserver 412 :No text to send\r\n");
+    client->queueMessage(makeReply(ERR_NOTEXTTOSEND));
     return;
   }
 
-  std::string target = cmd.params[0];
-  std::string text = cmd.trailing;
+  std::string target(cmd.params[0]);
+  std::string_view text = cmd.trailing;
 
   /* ===== CHANNEL MESSAGE ===== */
   if (!target.empty() && target[0] == '#') {
-    if (!server->_channels.count(target)) {
-      server->sendReply(client->getFd(), ERR_NOSUCHCHANNEL(target));
+    Channel *const *channel = server->_channelIndex.find(target);
+    if (!channel) {
+      client->queueMessage(makeReply(ERR_NOSUCHCHANNEL, target));
       return;
     }
 
-    Channel *channel = server->_channels[target];
-
-    if (!channel->hasClient(client)) {
-      server->sendReply(client->getFd(), ERR_CANNOTSENDTOCHAN(target));
+    if (!(*channel)->hasMember(client)) {
+      client->queueMessage(makeReply(ERR_CANNOTSENDTOCHAN, target));
       return;
     }
 
-    std::string msg = ":" + client->getNickname() + "!" +
-                      client->getUsername() + "@localhost PRIVMSG " + target +
-                      " :" + text + "\r\n";
-
-    channel->broadcast(msg, client);
+    (*channel)->broadcast(makeReply(MSG_PRIVMSG, client->getNickname(),
+                                    client->getUsername(), target, text),
+                          client);
     return;
   }
 
   /* ===== DIRECT MESSAGE ===== */
-  Client *receiver = server->getClientByNick(target);
+  const Route *receiver = server->findRoute(target);
   if (!receiver) {
-    server->sendReply(client->getFd(), ERR_NOSUCHNICK(target));
+    client->queueMessage(makeReply(ERR_NOSUCHNICK, target));
     return;
   }
 
-  std::string msg = ":" + client->getNickname() + "!" + client->getUsername() +
-                    "@localhost PRIVMSG " + target + " :" + text + "\r\n";
-
-  server->sendReply(receiver->getFd(), msg);
+  receiver->deliver(makeReply(MSG_PRIVMSG, client->getNickname(),
+                              client->getUsername(), target, text));
 }
 
 /* ============================= */
@@ -200,15 +196,14 @@ void CommandHandler::handlePRIVMSG(Server *server, Client *client,
 
 void CommandHandler::handlePING(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  if (cmd.params.empty()) {
-    server->sendReply(client->getFd(), ERR_NEEDMOREPARAMS("PING"));
-    return;
-  }
-
-  std::string pong = "PONG :" + cmd.params[0] + "\r\n";
-  server->sendReply(client->getFd(), pong);
+  (void)server;
+  client->queueMessage(makeReply(MSG_PONG, cmd.params[0]));
 }
 
+/**
+ * @brief Nothing to do: the reactor counts any input, this PONG included,
+ * as an answer to its keepalive PING (see Reactor::clientTimerFired).
+ */
 void CommandHandler::handlePONG(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
   (void)server;
@@ -217,20 +212,85 @@ void CommandHandler::handlePONG(Server *server, Client *client,
 }
 
 /* ============================= */
-/*         WHOIS LOGIC           */
+/*         STATS QUERIES         */
 /* ============================= */
 
-void CommandHandler::handleWHOIS(Server *server, Client *client,
+/**
+ * @brief Processes the OPER command: OPER <name> <password>.
+ *
+ * There is one operator password (--oper-password); the name is not
+ * checked. Without that flag nobody can become an operator. Only the
+ * sender and the read-only configuration are touched, so it runs without
+ * the state lock.
+ */
+void CommandHandler::handleOPER(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  if (!requireParams(server, client, cmd, 1, "WHOIS"))
+  const std::string &nick = client->getNickname();
+  const std::string &secret = server->_config.operPassword;
+  if (secret.empty()) {
+    client->queueMessage(makeReply(ERR_NOOPERHOST, nick));
+    return;
+  }
+  if (cmd.params[1] != secret) {
+    client->queueMessage(makeReply(ERR_PASSWDMISMATCH));
+    return;
+  }
+  client->setOper(true);
+  client->queueMessage(makeReply(RPL_YOUREOPER, nick));
+}
+
+/**
+ * @brief Processes the STATS command. Operators only (see handleOPER):
+ * the queries expose server internals.
+ *
+ * Supported queries:
+ *  - p: object pool occupancy (clients, input buffers, channels)
+ *  - m: lines received and queued per command
+ *  - z: every metric of the registry (also served to Prometheus)
+ *  - l: handler latency per command and read-to-dispatch delay
+ *  - q: queued output and the distribution of per-client send queue peaks
+ * Any other query only gets the end-of-stats reply.
+ */
+void CommandHandler::handleSTATS(Server *server, Client *client,
+                                 const ParsedCommand &cmd) {
+  std::string query = cmd.params.empty() ? "*" : std::string(cmd.params[0]);
+  const std::string &nick = client->getNickname();
+  if (!client->isOper()) {
+    server->sendReply(client->getFd(), makeReply(ERR_NOPRIVILEGES, nick));
     return;
+  }
+
+  std::vector<std::string> lines;
+  if (query == "p")
+    server->reportPools(lines);
+  else if (query == "m")
+    server->reportCommands(lines);
+  else if (query == "l")
+    server->reportLatency(lines);
+  else if (query == "q")
+    server->reportSendq(lines); // under the shared state lock as well
+  else if (query == "z") {
+    server->refreshMetrics(); // STATS runs under the shared state lock
+    metrics().registry.renderStats(lines);
+  }
+  for (size_t i = 0; i < lines.size(); ++i)
+    server->sendReply(client->getFd(),
+                      makeReply(RPL_STATSDEBUG, nick, query, lines[i]));
+  server->sendReply(client->getFd(), makeReply(RPL_ENDOFSTATS, nick, query));
+}
 
-  std::string targetNick = cmd.params[0];
+/* ============================= */
+/*         WHOIS LOGIC           */
+/* ============================= */
+
+void CommandHandler::handleWHOIS(Server *server, Client *client,
+                                const ParsedCommand &cmd) {
+  std::string targetNick(cmd.params[0]);
   Client *target = resolveClientOrReply(server, client, targetNick);
   if (!target)
     return;
 
-  server->sendReply(client->getFd(), RPL_WHOISUSER(
+  server->sendReply(client->getFd(), makeReply(RPL_WHOISUSER,
     target->getNickname(),
     target->getUsername(),
     "localhost",
@@ -246,13 +306,13 @@ void CommandHandler::handleWHOIS(Server *server, Client *client,
   }
 
   // Reply with WHOISCHANNELS
-  server->sendReply(client->getFd(), RPL_WHOISCHANNELS(
+  server->sendReply(client->getFd(), makeReply(RPL_WHOISCHANNELS,
     target->getNickname(),
     chanList
   ));
 
   // End of WHOIS
-  server->sendReply(client->getFd(), RPL_ENDOFWHOIS(
+  server->sendReply(client->getFd(), makeReply(RPL_ENDOFWHOIS,
     target->getNickname()
   ));
 }
\ No newline at end of file
@@ -17,10 +17,7 @@
  */
 void CommandHandler::handleINVITE(Server *server, Client *client,
                                   const ParsedCommand &cmd) {
-  if (!requireParams(server, client, cmd, 2, "INVITE"))
-    return;
-
-  std::string targetNick = cmd.params[0];
+  std::string targetNick(cmd.params[0]);
   Channel *channel =
       expectChannel(server, client, cmd.params[1], "INVITE", true, true, true);
   if (!channel)
@@ -29,14 +26,15 @@ void CommandHandler::handleINVITE(Server *server, Client *client,
   Client *target = resolveClientOrReply(server, client, targetNick);
   if (!target)
     return;
-  channel->inviteNickname(targetNick);
+  server->addInvite(channel, target);
 
 
-  std::string inviteMsg = makePrefix(client) + " INVITE " + targetNick +
-                          " " + channel->getName() + "\r\n";
-  server->sendReply(target->getFd(), inviteMsg);
+  server->sendReply(target->getFd(),
+                    makeReply(MSG_INVITE, client->getNickname(),
+                              client->getUsername(), targetNick,
+                              channel->getName()));
   server->sendReply(client->getFd(),
-                    RPL_INVITING(targetNick, channel->getName()));
+                    makeReply(RPL_INVITING, targetNick, channel->getName()));
 }
 
 /* ============================= */
@@ -57,20 +55,15 @@ void CommandHandler::handleINVITE(Server *server, Client *client,
  */
 void CommandHandler::handleJOIN(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  if (!requireParams(server, client, cmd, 1, "JOIN"))
-    return;
-
   std::vector<std::string> channels = splitCommaList(cmd.params[0]);
   std::vector<std::string> keys;
   if (cmd.params.size() > 1)
     keys = splitCommaList(cmd.params[1]);
   if (channels.empty()) {
-    server->sendReply(client->getFd(), ERR_NEEDMOREPARAMS("JOIN"));
+    server->sendReply(client->getFd(), makeReply(ERR_NEEDMOREPARAMS, "JOIN"));
     return;
   }
 
-  std::string prefix = makePrefix(client);
-
   for (size_t idx = 0; idx < channels.size(); ++idx) {
     std::string chanName = ensureChannelPrefix(channels[idx]);
     if (chanName.empty())
@@ -79,17 +72,20 @@ void CommandHandler::handleJOIN(Server *server, Client *client,
     Channel *channel = server->getOrCreateChannel(chanName);
     std::string providedKey = idx < keys.size() ? keys[idx] : std::string();
     if (channel->hasKey() && providedKey != channel->getKey()) {
-      server->sendReply(client->getFd(), ERR_BADCHANNELKEY(chanName));
+      server->sendReply(client->getFd(),
+                        makeReply(ERR_BADCHANNELKEY, chanName));
       continue;
     }
-    if (channel->isInviteOnly() && !channel->isInvited(client->getNickname()) &&
+    if (channel->isInviteOnly() && !channel->isInvited(client) &&
         !channel->isOperator(client)) {
-      server->sendReply(client->getFd(), ERR_INVITEONLYCHAN(chanName));
+      server->sendReply(client->getFd(),
+                        makeReply(ERR_INVITEONLYCHAN, chanName));
       continue;
     }
     if (channel->hasLimit() && channel->isFull() &&
         !channel->isOperator(client)) {
-      server->sendReply(client->getFd(), ERR_CHANNELISFULL(chanName));
+      server->sendReply(client->getFd(),
+                        makeReply(ERR_CHANNELISFULL, chanName));
       continue;
     }
     if (channel->hasClient(client)) {
@@ -98,38 +94,38 @@ void CommandHandler::handleJOIN(Server *server, Client *client,
 
     channel->addClient(client);
     client->joinChannel(channel);
-    channel->removeInvited(client->getNickname()); 
+    channel->removeInvited(client);
     
     if (channel->getClients().size() == 1) {
       channel->addOperator(client);
     }
 
-    std::string joinMsg = prefix + " JOIN " + chanName + "\r\n";
-    channel->broadcast(joinMsg, NULL);
-
-    const std::vector<Client *> &members = channel->getClients();
-    std::string names = ":ircserver 353 " + client->getNickname() + " = " +
-                        chanName + " :";
-    for (size_t i = 0; i < members.size(); ++i) {
-      names += members[i]->getNickname();
-      if (i + 1 < members.size())
-        names += " ";
+    channel->broadcast(makeReply(MSG_JOIN, client->getNickname(),
+                                 client->getUsername(), chanName),
+                       NULL);
+
+    // one shared header, then a reference to each cached names chunk
+    std::vector<SharedLine> names;
+    channel->collectNames(names);
+    SharedLine head =
+        makeReply(RPL_NAMREPLY_HEAD, client->getNickname(), chanName);
+    for (size_t i = 0; i < names.size(); ++i) {
+      server->sendReply(client->getFd(), head);
+      server->sendReply(client->getFd(), names[i]);
     }
-    names += "\r\n";
-    server->sendReply(client->getFd(), names);
-
-    std::string endMsg = ":ircserver 366 " +
-                         client->getNickname() + " " + chanName +
-                         " :End of NAMES list\r\n";
-    server->sendReply(client->getFd(), endMsg);
+    server->sendReply(client->getFd(), makeReply(RPL_ENDOFNAMES,
+                                                 client->getNickname(),
+                                                 chanName));
 
     const std::string &topic = channel->getTopic();
     if (!topic.empty()) {
-      server->sendReply(client->getFd(),
-                        RPL_TOPIC(client->getNickname(), chanName, topic));
+      server->sendReply(client->getFd(), makeReply(RPL_TOPIC,
+                                                   client->getNickname(),
+                                                   chanName, topic));
     } else {
-      server->sendReply(client->getFd(),
-                        RPL_NOTOPIC(client->getNickname(), chanName));
+      server->sendReply(client->getFd(), makeReply(RPL_NOTOPIC,
+                                                   client->getNickname(),
+                                                   chanName));
     }
   }
 }
@@ -151,9 +147,6 @@ void CommandHandler::handleJOIN(Server *server, Client *client,
  */
 void CommandHandler::handlePART(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  if (!requireParams(server, client, cmd, 1, "PART"))
-    return;
-
   Channel *channel =
       expectChannel(server, client, cmd.params[0], "PART", true, true);
   if (!channel)
@@ -162,11 +155,9 @@ void CommandHandler::handlePART(Server *server, Client *client,
   channel->removeClient(client);
   client->leaveChannel(channel);
 
-  std::string partMsg = ":" + client->getNickname() + "!" +
-                        client->getUsername() + "@localhost PART " +
-                        channel->getName() + "\r\n";
-
-  channel->broadcast(partMsg, NULL);
+  channel->broadcast(makeReply(MSG_PART, client->getNickname(),
+                               client->getUsername(), channel->getName()),
+                     NULL);
 
   server->cleanupChannel(channel->getName());
 }
@@ -189,10 +180,7 @@ void CommandHandler::handlePART(Server *server, Client *client,
  */
 void CommandHandler::handleKICK(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  if (!requireParams(server, client, cmd, 2, "KICK"))
-    return;
-
-  std::string targetNick = cmd.params[1];
+  std::string targetNick(cmd.params[1]);
   Channel *channel =
       expectChannel(server, client, cmd.params[0], "KICK", true, true, true);
   if (!channel)
@@ -203,15 +191,15 @@ void CommandHandler::handleKICK(Server *server, Client *client,
     return;
 
   if (!channel->hasClient(target)) {
-    server->sendReply(client->getFd(), ERR_NOTONCHANNEL(channel->getName()));
+    server->sendReply(client->getFd(),
+                      makeReply(ERR_NOTONCHANNEL, channel->getName()));
     return;
   }
 
-  std::string kickMsg = ":" + client->getNickname() + "!" +
-                        client->getUsername() + "@localhost KICK " +
-                        channel->getName() + " " + targetNick + "\r\n";
-
-  channel->broadcast(kickMsg, NULL);
+  channel->broadcast(makeReply(MSG_KICK, client->getNickname(),
+                               client->getUsername(), channel->getName(),
+                               targetNick),
+                     NULL);
 
   channel->removeClient(target);
   target->leaveChannel(channel);
@@ -1,23 +1,14 @@
 #include "../includes/CommandHandlerHelpers.hpp"
 #include "../includes/CommandHandler.hpp"
 
-bool CommandHandler::requireParams(Server *server, Client *client, const ParsedCommand &cmd,
-                   size_t expectedCount, const std::string &cmdName) {
-  if (cmd.params.size() < expectedCount) {
-    server->sendReply(client->getFd(), ERR_NEEDMOREPARAMS(cmdName));
-    return false;
-  }
-  return true;
-}
-
 Channel *CommandHandler::expectChannel(Server *server, Client *client,
-                       const std::string &rawName,
+                       std::string_view rawName,
                        const std::string &cmdName, bool mustExist,
                        bool requireMember, bool requireOperator) {
   std::string chanName = ensureChannelPrefix(rawName);
 
   if (mustExist && !server->_channels.count(chanName)) {
-    server->sendReply(client->getFd(), ERR_NOSUCHCHANNEL(chanName));
+    server->sendReply(client->getFd(), makeReply(ERR_NOSUCHCHANNEL, chanName));
     return NULL;
   }
 
@@ -26,12 +17,12 @@ Channel *CommandHandler::expectChannel(Server *server, Client *client,
     channel = server->_channels[chanName];
 
   if (requireMember && channel && !channel->hasClient(client)) {
-    server->sendReply(client->getFd(), ERR_NOTONCHANNEL(chanName));
+    server->sendReply(client->getFd(), makeReply(ERR_NOTONCHANNEL, chanName));
     return NULL;
   }
 
   if (requireOperator && channel && !channel->isOperator(client)) {
-    server->sendReply(client->getFd(), ERR_CHANOPRIVSNEEDED(chanName));
+    server->sendReply(client->getFd(), makeReply(ERR_CHANOPRIVSNEEDED, chanName));
     return NULL;
   }
   (void)cmdName;
@@ -40,7 +31,7 @@ Channel *CommandHandler::expectChannel(Server *server, Client *client,
 
 
 bool CommandHandler::ensureModeTargetProvided(Server *server, Client *client) {
-  server->sendReply(client->getFd(), ERR_NEEDMOREPARAMS("MODE"));
+  server->sendReply(client->getFd(), makeReply(ERR_NEEDMOREPARAMS, "MODE"));
   return false;
 }
 
@@ -48,7 +39,7 @@ Client *CommandHandler::resolveClientOrReply(Server *server, Client *client,
                              const std::string &nick) {
   Client *target = server->getClientByNick(nick);
   if (!target)
-    server->sendReply(client->getFd(), ERR_NOSUCHNICK(nick));
+    server->sendReply(client->getFd(), makeReply(ERR_NOSUCHNICK, nick));
   return target;
 }
 
@@ -56,32 +47,30 @@ bool CommandHandler::ensureValidLimit(Server *server, Client *client, const std:
                       int &outLimit) {
   outLimit = std::atoi(arg.c_str());
   if (outLimit <= 0) {
-    server->sendReply(client->getFd(), ERR_NEEDMOREPARAMS("MODE"));
+    server->sendReply(client->getFd(), makeReply(ERR_NEEDMOREPARAMS, "MODE"));
     return false;
   }
   return true;
 }
 
-std::string ensureChannelPrefix(const std::string &name) {
-  if (name.empty())
-    return name;
-  if (name[0] != '#')
-    return "#" + name;
-  return name;
-}
-
-std::string makePrefix(Client *client) {
-  return ":" + client->getNickname() + "!" + client->getUsername() +
-         "@localhost";
+std::string ensureChannelPrefix(std::string_view name) {
+  std::string result;
+  if (!name.empty() && name[0] != '#')
+    result = "#";
+  result.append(name);
+  return result;
 }
 
-std::vector<std::string> splitCommaList(const std::string &list) {
+std::vector<std::string> splitCommaList(std::string_view list) {
   std::vector<std::string> result;
-  std::istringstream iss(list);
-  std::string item;
+  size_t start = 0;
 
-  while (std::getline(iss, item, ',')) {
-    result.push_back(item);
+  while (start < list.size()) {
+    size_t comma = list.find(',', start);
+    if (comma == std::string_view::npos)
+      comma = list.size();
+    result.push_back(std::string(list.substr(start, comma - start)));
+    start = comma + 1;
   }
 
   return result;
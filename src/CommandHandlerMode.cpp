@@ -29,8 +29,8 @@ std::string modes = "+";
       args += " " + ss.str();
 	}
 	server->sendReply(client.getFd(),
-                      RPL_CHANNELMODEIS(client.getNickname(), chanName,
-                                        modes + args));
+                      makeReply(RPL_CHANNELMODEIS, client.getNickname(),
+                                chanName, modes + args));
     return;
 }
 
@@ -45,11 +45,10 @@ std::string modes = "+";
 */
 void CommandHandler::handleMODE(Server *server, Client *client,
                                 const ParsedCommand &cmd) {
-  if (!requireParams(server, client, cmd, 1, "MODE"))
-    return;
-
   std::string chanName = ensureChannelPrefix(cmd.params[0]);
-  std::string mode = cmd.params.size() >= 2 ? cmd.params[1] : "";
+  std::string mode;
+  if (cmd.params.size() >= 2)
+    mode = cmd.params[1];
 
   Channel *channel =
       expectChannel(server, client, chanName, "MODE", true, true);
@@ -59,15 +58,17 @@ void CommandHandler::handleMODE(Server *server, Client *client,
 		return replyActiveModes(server, *channel, *client);
 
   if (!channel->isOperator(client)) {
-    server->sendReply(client->getFd(), ERR_CHANOPRIVSNEEDED(chanName));
+    server->sendReply(client->getFd(),
+                      makeReply(ERR_CHANOPRIVSNEEDED, chanName));
     return;
   }
 
   std::string target;
   if (cmd.params.size() >= 3)
     target = cmd.params[2];
-  std::string prefix = makePrefix(client);
-  std::string modeMsg;
+  const std::string &nick = client->getNickname();
+  const std::string &user = client->getUsername();
+  SharedLine modeMsg;
 
   const bool addFlag = !mode.empty() && mode[0] == '+';
   const char flag = mode.size() > 1 ? mode[1] : '\0';
@@ -79,12 +80,17 @@ void CommandHandler::handleMODE(Server *server, Client *client,
     Client *targetClient = resolveClientOrReply(server, client, target);
     if (!targetClient)
       return;
+    if (!channel->hasClient(targetClient)) {
+      server->sendReply(client->getFd(), makeReply(ERR_USERNOTINCHANNEL,
+                                                   target, chanName));
+      return;
+    }
     if (addFlag)
       channel->addOperator(targetClient);
     else
       channel->removeOperator(targetClient);
-    modeMsg = prefix + " MODE " + chanName + (addFlag ? " +o " : " -o ") +
-              target + "\r\n";
+    modeMsg = makeReply(MSG_MODE_ARG, nick, user, chanName,
+                        addFlag ? "+o" : "-o", target);
     break;
   }
   case 'k': {
@@ -92,16 +98,16 @@ void CommandHandler::handleMODE(Server *server, Client *client,
       if (target.empty() && !ensureModeTargetProvided(server, client))
         return;
       channel->setKey(target);
-      modeMsg = prefix + " MODE " + chanName + " +k " + target + "\r\n";
+      modeMsg = makeReply(MSG_MODE_ARG, nick, user, chanName, "+k", target);
     } else {
       channel->clearKey();
-      modeMsg = prefix + " MODE " + chanName + " -k\r\n";
+      modeMsg = makeReply(MSG_MODE, nick, user, chanName, "-k");
     }
     break;
   }
   case 'i': {
     channel->setInviteOnly(addFlag);
-    modeMsg = prefix + " MODE " + chanName + (addFlag ? " +i\r\n" : " -i\r\n");
+    modeMsg = makeReply(MSG_MODE, nick, user, chanName, addFlag ? "+i" : "-i");
     break;
   }
   case 'l': {
@@ -112,21 +118,21 @@ void CommandHandler::handleMODE(Server *server, Client *client,
       if (!ensureValidLimit(server, client, target, limit))
         return;
       channel->setLimit(limit);
-      modeMsg = prefix + " MODE " + chanName + " +l " + target + "\r\n";
+      modeMsg = makeReply(MSG_MODE_ARG, nick, user, chanName, "+l", target);
     } else {
       channel->clearLimit();
-      modeMsg = prefix + " MODE " + chanName + " -l\r\n";
+      modeMsg = makeReply(MSG_MODE, nick, user, chanName, "-l");
     }
     break;
   }
   case 't': {
     channel->setTopicProtected(addFlag);
-    modeMsg = prefix + " MODE " + chanName + (addFlag ? " +t\r\n" : " -t\r\n");
+    modeMsg = makeReply(MSG_MODE, nick, user, chanName, addFlag ? "+t" : "-t");
     break;
   }
   default:
     server->sendReply(client->getFd(),
-                      prefix + " MODE " + chanName + " " + mode + "\r\n");
+                      makeReply(MSG_MODE, nick, user, chanName, mode));
     return;
   }
 
@@ -145,9 +151,6 @@ void CommandHandler::handleMODE(Server *server, Client *client,
  */
 void CommandHandler::handleTOPIC(Server *server, Client *client,
                                  const ParsedCommand &cmd) {
-  if (!requireParams(server, client, cmd, 1, "TOPIC"))
-    return;
-
   std::string chanName = ensureChannelPrefix(cmd.params[0]);
   Channel *channel =
       expectChannel(server, client, chanName, "TOPIC", true, true);
@@ -158,30 +161,33 @@ void CommandHandler::handleTOPIC(Server *server, Client *client,
     const std::string &topic = channel->getTopic();
     if (topic.empty()) {
       server->sendReply(client->getFd(),
-                        RPL_NOTOPIC(client->getNickname(), chanName));
+                        makeReply(RPL_NOTOPIC, client->getNickname(), chanName));
     } else {
-      server->sendReply(client->getFd(),
-                        RPL_TOPIC(client->getNickname(), chanName, topic));
+      server->sendReply(client->getFd(), makeReply(RPL_TOPIC,
+                                                   client->getNickname(),
+                                                   chanName, topic));
     }
     return;
   }
 
   if (channel->isTopicProtected() && !channel->isOperator(client)) {
-    server->sendReply(client->getFd(), ERR_CHANOPRIVSNEEDED(chanName));
+    server->sendReply(client->getFd(),
+                      makeReply(ERR_CHANOPRIVSNEEDED, chanName));
     return;
   }
   if (cmd.trailing.length() > 300) {
-    server->sendReply(client->getFd(),
-                      ":ircserver 422 " + client->getNickname() +
-                          " " + chanName +
-                          " :Topic is too long (maximum 300 characters)\r\n");
+    server->sendReply(client->getFd(), makeReply(ERR_TOPICTOOLONG,
+                                                 client->getNickname(),
+                                                 chanName));
     return;
   }
   
-  channel->setTopic(cmd.trailing);
-  std::string topicLine = makePrefix(client) + " TOPIC " + chanName +
-                          " :" + cmd.trailing + "\r\n";
-  channel->broadcast(topicLine, NULL);
-  server->sendReply(client->getFd(),
-                    RPL_TOPIC(client->getNickname(), chanName, cmd.trailing));
+  std::string topic(cmd.trailing);
+  channel->setTopic(topic);
+  channel->broadcast(makeReply(MSG_TOPIC, client->getNickname(),
+                               client->getUsername(), chanName, topic),
+                     NULL);
+  server->sendReply(client->getFd(), makeReply(RPL_TOPIC,
+                                               client->getNickname(),
+                                               chanName, topic));
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+ * @file CommandTable.cpp
+ * @brief Command descriptors and their compile-time hash index.
+ */
+
+#include "../includes/CommandTable.hpp"
+#include "../includes/CommandHandler.hpp"
+
+/* ============================= */
+/*          DESCRIPTORS          */
+/* ============================= */
+
+enum {
+  CMD_PASS,
+  CMD_NICK,
+  CMD_USER,
+  CMD_QUIT,
+  CMD_PING,
+  CMD_PONG,
+  CMD_JOIN,
+  CMD_PART,
+  CMD_PRIVMSG,
+  CMD_KICK,
+  CMD_MODE,
+  CMD_TOPIC,
+  CMD_INVITE,
+  CMD_WHOIS,
+  CMD_STATS,
+  CMD_OPER,
+  CMD_COUNT
+};
+
+static std::atomic<unsigned long> g_calls[CMD_COUNT];
+
+/* name, handler, min params, registration required, read-only, flood cost,
+ * counter */
+static constexpr CommandDescriptor COMMANDS[CMD_COUNT] = {
+    {"PASS", &CommandHandler::handlePASS, 1, false, LOCK_EXCLUSIVE, 1,
+     &g_calls[CMD_PASS]},
+    {"NICK", &CommandHandler::handleNICK, 0, false, LOCK_EXCLUSIVE, 2,
+     &g_calls[CMD_NICK]},
+    {"USER", &CommandHandler::handleUSER, 3, false, LOCK_EXCLUSIVE, 1,
+     &g_calls[CMD_USER]},
+    {"QUIT", &CommandHandler::handleQUIT, 0, false, LOCK_EXCLUSIVE, 1,
+     &g_calls[CMD_QUIT]},
+    {"PING", &CommandHandler::handlePING, 1, false, LOCK_NONE, 1,
+     &g_calls[CMD_PING]},
+    {"PONG", &CommandHandler::handlePONG, 0, false, LOCK_NONE, 1,
+     &g_calls[CMD_PONG]},
+    {"JOIN", &CommandHandler::handleJOIN, 1, true, LOCK_EXCLUSIVE, 3,
+     &g_calls[CMD_JOIN]},
+    {"PART", &CommandHandler::handlePART, 1, true, LOCK_EXCLUSIVE, 2,
+     &g_calls[CMD_PART]},
+    {"PRIVMSG", &CommandHandler::handlePRIVMSG, 0, true, LOCK_NONE, 2,
+     &g_calls[CMD_PRIVMSG]},
+    {"KICK", &CommandHandler::handleKICK, 2, true, LOCK_EXCLUSIVE, 2,
+     &g_calls[CMD_KICK]},
+    {"MODE", &CommandHandler::handleMODE, 1, true, LOCK_EXCLUSIVE, 2,
+     &g_calls[CMD_MODE]},
+    {"TOPIC", &CommandHandler::handleTOPIC, 1, true, LOCK_EXCLUSIVE, 2,
+     &g_calls[CMD_TOPIC]},
+    {"INVITE", &CommandHandler::handleINVITE, 2, true, LOCK_EXCLUSIVE, 2,
+     &g_calls[CMD_INVITE]},
+    {"WHOIS", &CommandHandler::handleWHOIS, 1, true, LOCK_SHARED, 3,
+     &g_calls[CMD_WHOIS]},
+    {"STATS", &CommandHandler::handleSTATS, 0, true, LOCK_SHARED, 4,
+     &g_calls[CMD_STATS]},
+    {"OPER", &CommandHandler::handleOPER, 2, true, LOCK_NONE, 2,
+     &g_calls[CMD_OPER]},
+};
+
+/* ============================= */
+/*           HASH INDEX          */
+/* ============================= */
+
+static const unsigned HASH_SLOTS = 32; // power of two
+
+constexpr unsigned char foldCase(char c) {
+  return (c >= 'a' && c <= 'z') ? static_cast<unsigned char>(c - 'a' + 'A')
+                                : static_cast<unsigned char>(c);
+}
+
+/* Callers guarantee name.size() >= 2 (no command is shorter) */
+constexpr unsigned commandHash(std::string_view name) {
+  return (static_cast<unsigned>(name.size()) + foldCase(name[0]) +
+          10u * foldCase(name[1]) + 13u * foldCase(name[name.size() - 1])) &
+         (HASH_SLOTS - 1);
+}
+
+struct HashIndex {
+  signed char slot[HASH_SLOTS]; // descriptor index or -1
+};
+
+/* Throwing here is not a constant expression: collisions fail the build */
+constexpr HashIndex buildIndex() {
+  HashIndex index = {};
+  for (unsigned i = 0; i < HASH_SLOTS; ++i)
+    index.slot[i] = -1;
+  for (int i = 0; i < CMD_COUNT; ++i) {
+    unsigned h = commandHash(COMMANDS[i].name);
+    if (index.slot[h] != -1)
+      throw "command hash collision: adjust commandHash()";
+    index.slot[h] = static_cast<signed char>(i);
+  }
+  return index;
+}
+
+static constexpr HashIndex INDEX = buildIndex();
+
+/* ============================= */
+/*             LOOKUP            */
+/* ============================= */
+
+/**
+ * @brief Maps a command name, in any case, to its descriptor.
+ * @return NULL for unknown commands.
+ */
+const CommandDescriptor *CommandTable::find(std::string_view name) {
+  if (name.size() < 2)
+    return NULL;
+  int i = INDEX.slot[commandHash(name)];
+  if (i < 0)
+    return NULL;
+
+  const CommandDescriptor &desc = COMMANDS[i];
+  if (desc.name.size() != name.size())
+    return NULL;
+  for (size_t c = 0; c < name.size(); ++c) {
+    if (foldCase(name[c]) != static_cast<unsigned char>(desc.name[c]))
+      return NULL;
+  }
+  return &desc;
+}
+
+size_t CommandTable::size() { return CMD_COUNT; }
+
+const CommandDescriptor &CommandTable::at(size_t index) {
+  return COMMANDS[index];
+}
+
+/* Position of a descriptor returned by find(), for per-command arrays */
+size_t CommandTable::indexOf(const CommandDescriptor &desc) {
+  return static_cast<size_t>(&desc - COMMANDS);
+}
@@ -0,0 +1,148 @@
+/**
+ * @file InputBuffer.cpp
+ * @brief Linear per-client receive buffer with zero-copy line framing.
+ */
+
+#include "../includes/InputBuffer.hpp"
+
+#include <cstring>
+
+InputBuffer::InputBuffer()
+    : _pool(NULL), _data(NULL), _start(0), _end(0), _scan(0),
+      _tail(MIN_TAIL) {}
+
+InputBuffer::~InputBuffer() {
+  if (_pool)
+    _pool->destroy(_data);
+  else
+    delete _data;
+}
+
+/**
+ * @brief Takes the storage from pool from now on. Must be called before
+ * the first write.
+ */
+void InputBuffer::setPool(BlockPool *pool) {
+  if (!_data)
+    _pool = pool;
+}
+
+/**
+ * @brief Returns where the next recv() should write, making room first.
+ *
+ * Steps:
+ *  - Allocate the storage on first use
+ *  - If everything was consumed, restart at the front (no copy)
+ *  - If the free tail is shorter than this client's reads need, move the
+ *    partial line to the front
+ *
+ * Invalidates views returned by nextLine().
+ */
+char *InputBuffer::writePtr() {
+  if (!_data)
+    _data = _pool ? _pool->create() : new Block;
+
+  if (_start == _end) {
+    _start = _end = _scan = 0;
+  } else if (_start > 0 && CAPACITY - _end < _tail) {
+    std::memmove(_data->bytes, _data->bytes + _start, _end - _start);
+    _end -= _start;
+    _scan -= _start;
+    _start = 0;
+  }
+  return _data->bytes + _end;
+}
+
+/**
+ * @brief Free bytes after writePtr(); 0 when a full line is still pending.
+ */
+size_t InputBuffer::writeSpace() const {
+  return _data ? CAPACITY - _end : 0;
+}
+
+/**
+ * @brief Marks bytes written at writePtr() as received.
+ */
+void InputBuffer::commit(size_t bytes) { _end += bytes; }
+
+/**
+ * @brief Adapts the wanted free tail to the size of the client's reads:
+ * doubled when a read takes all of it, halved when one uses less than a
+ * quarter.
+ */
+void InputBuffer::recordRead(size_t bytes) {
+  if (bytes >= _tail && _tail < MAX_TAIL)
+    _tail *= 2;
+  else if (bytes < _tail / 4 && _tail > MIN_TAIL)
+    _tail /= 2;
+}
+
+/**
+ * @brief Copies as much of data as fits (used when the kernel filled a
+ * buffer of its own, e.g. io_uring provided buffers).
+ * @return Number of bytes taken; the caller retries the rest after
+ * draining lines with nextLine().
+ */
+size_t InputBuffer::append(const char *data, size_t length) {
+  char *dst = writePtr();
+  size_t n = length < writeSpace() ? length : writeSpace();
+  std::memcpy(dst, data, n);
+  commit(n);
+  return n;
+}
+
+/**
+ * @brief Extracts the next complete line.
+ *
+ * Splits on '\n' and drops an optional '\r' before it. Bytes already
+ * scanned for a newline are not scanned again on the next call.
+ *
+ * @param line Set to a view of the line (without CRLF) on success.
+ * @return false if no complete line is buffered.
+ */
+bool InputBuffer::nextLine(std::string_view &line) {
+  if (_scan >= _end)
+    return (false);
+
+  const char *base = _data->bytes;
+  const char *nl = static_cast<const char *>(
+      std::memchr(base + _scan, '\n', _end - _scan));
+  if (!nl) {
+    _scan = _end;
+    return (false);
+  }
+
+  size_t pos = nl - base;
+  size_t length = pos - _start;
+  if (length > 0 && base[pos - 1] == '\r')
+    --length;
+  line = std::string_view(base + _start, length);
+  _start = _scan = pos + 1;
+  return (true);
+}
+
+/**
+ * @brief Puts back the line last returned by nextLine(), so the next call
+ * returns it again; defers a line without copying it.
+ */
+void InputBuffer::unread(std::string_view line) {
+  _start = _scan = line.data() - _data->bytes;
+}
+
+/**
+ * @brief True when CAPACITY bytes are pending without a single newline;
+ * the client can never complete that line and must be dropped.
+ *
+ * A buffer filled with complete lines (deferred by flood control) is not
+ * an overflow. Only the bytes past _scan can still hold a newline, and
+ * they are only searched once the buffer is full.
+ */
+bool InputBuffer::overflowed() const {
+  if (_end - _start < CAPACITY)
+    return false;
+  return !std::memchr(_data->bytes + _scan, '\n', _end - _scan);
+}
+
+size_t InputBuffer::size() const { return _end - _start; }
+
+void InputBuffer::clear() { _start = _end = _scan = 0; }
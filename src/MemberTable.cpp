@@ -0,0 +1,259 @@
+/**
+ * @file MemberTable.cpp
+ * @brief Open-addressing membership table used by Channel.
+ */
+
+#include "../includes/MemberTable.hpp"
+#include "../includes/Client.hpp"
+
+static const size_t MIN_BUCKETS = 8;
+
+MemberTable::MemberTable() : _buckets(MIN_BUCKETS), _used(0) {
+  for (size_t i = 0; i < _buckets.size(); ++i)
+    _buckets[i].client = NULL;
+}
+
+MemberTable::~MemberTable() {}
+
+/* ============================= */
+/*            LOOKUP             */
+/* ============================= */
+
+/**
+ * @brief Preferred bucket of a client: Fibonacci hashing of the pointer.
+ * Heap pointers share their low bits, so the high product bits are used.
+ */
+size_t MemberTable::home(const Client *client) const {
+  uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(client)) *
+               0x9E3779B97F4A7C15ull;
+  return static_cast<size_t>(h >> 32) & (_buckets.size() - 1);
+}
+
+/**
+ * @brief Returns the bucket holding client, or the empty bucket that ends
+ * its probe sequence. The table is never full, so this terminates.
+ */
+size_t MemberTable::probe(const Client *client) const {
+  size_t mask = _buckets.size() - 1;
+  size_t pos = home(client);
+  while (_buckets[pos].client && _buckets[pos].client != client)
+    pos = (pos + 1) & mask;
+  return pos;
+}
+
+/**
+ * @brief Returns the live record of client. A record left behind by an
+ * earlier connection at the same address does not count.
+ */
+MemberTable::Record *MemberTable::find(const Client *client) {
+  Record &rec = _buckets[probe(client)];
+  return rec.client && rec.id == client->getId() ? &rec : NULL;
+}
+
+const MemberTable::Record *MemberTable::find(const Client *client) const {
+  const Record &rec = _buckets[probe(client)];
+  return rec.client && rec.id == client->getId() ? &rec : NULL;
+}
+
+/* ============================= */
+/*          MODIFICATION         */
+/* ============================= */
+
+/**
+ * @brief Returns the record of client, creating an empty one if needed.
+ * A stale record at the same address is purged first. Grows the table
+ * before it gets more than half full.
+ */
+MemberTable::Record &MemberTable::insert(Client *client) {
+  size_t pos = probe(client);
+  if (_buckets[pos].client) {
+    if (_buckets[pos].id == client->getId())
+      return _buckets[pos];
+    purgeAt(pos);
+    pos = probe(client);
+  }
+
+  if ((_used + 1) * 2 > _buckets.size()) {
+    rehash(_buckets.size() * 2);
+    pos = probe(client);
+  }
+  Record &rec = _buckets[pos];
+  rec.client = client;
+  rec.id = client->getId();
+  rec.member = NO_SLOT;
+  rec.tag = 0;
+  rec.flags = 0;
+  ++_used;
+  return rec;
+}
+
+/**
+ * @brief Drops the record at pos, taking it out of the member array too.
+ * The last member is moved into the freed position.
+ */
+void MemberTable::purgeAt(size_t pos) {
+  Record &rec = _buckets[pos];
+  if (rec.flags & MEMBER) {
+    Client *last = _members.back();
+    if (last != rec.client) {
+      _members[rec.member] = last;
+      _buckets[probe(last)].member = rec.member;
+    }
+    _members.pop_back();
+  }
+  eraseAt(pos);
+}
+
+/**
+ * @brief Empties a bucket and shifts later entries of the same cluster back
+ * into it when that brings them closer to their home bucket.
+ */
+void MemberTable::eraseAt(size_t pos) {
+  size_t mask = _buckets.size() - 1;
+  size_t hole = pos;
+  size_t next = pos;
+
+  for (;;) {
+    next = (next + 1) & mask;
+    if (!_buckets[next].client)
+      break;
+    size_t want = home(_buckets[next].client);
+    // Leave the entry alone if its home lies cyclically in (hole, next]
+    bool stays = hole <= next ? (hole < want && want <= next)
+                              : (hole < want || want <= next);
+    if (stays)
+      continue;
+    _buckets[hole] = _buckets[next];
+    hole = next;
+  }
+  _buckets[hole].client = NULL;
+  --_used;
+}
+
+void MemberTable::dropIfUnused(Record &rec) {
+  if (rec.flags == 0)
+    eraseAt(static_cast<size_t>(&rec - &_buckets[0]));
+}
+
+void MemberTable::rehash(size_t capacity) {
+  std::vector<Record> old;
+  old.swap(_buckets);
+  _buckets.resize(capacity);
+  for (size_t i = 0; i < capacity; ++i)
+    _buckets[i].client = NULL;
+
+  _used = 0;
+  for (size_t i = 0; i < old.size(); ++i) {
+    if (!old[i].client || old[i].flags == 0)
+      continue;
+    _buckets[probe(old[i].client)] = old[i];
+    ++_used;
+  }
+}
+
+/**
+ * @brief Makes client a member. Returns false if it already was one.
+ */
+bool MemberTable::add(Client *client) {
+  Record &rec = insert(client);
+  if (rec.flags & MEMBER)
+    return false;
+  rec.flags |= MEMBER;
+  rec.member = static_cast<uint32_t>(_members.size());
+  _members.push_back(client);
+  return true;
+}
+
+/**
+ * @brief Forgets client entirely (membership and every status bit).
+ *
+ * Returns false if client was not a member. A stale record at the same
+ * address is dropped as well.
+ */
+bool MemberTable::remove(Client *client) {
+  size_t pos = probe(client);
+  Record &rec = _buckets[pos];
+  if (!rec.client)
+    return false;
+
+  bool wasMember = rec.id == client->getId() && (rec.flags & MEMBER) != 0;
+  purgeAt(pos);
+  return wasMember;
+}
+
+bool MemberTable::contains(Client *client) const {
+  return hasFlags(client, MEMBER);
+}
+
+/**
+ * @brief Sets status bits on client. MEMBER is only changed by add().
+ *
+ * Returns false without touching the table when a bit other than INVITED
+ * is asked for on a client that is not a member: remove() is what drops
+ * records, so a status record without membership would never go away.
+ */
+bool MemberTable::setFlags(Client *client, uint8_t flags) {
+  flags &= ~MEMBER;
+  if (!flags)
+    return true;
+  if ((flags & ~INVITED) && !contains(client))
+    return false;
+  insert(client).flags |= flags;
+  return true;
+}
+
+/**
+ * @brief Clears status bits on client. MEMBER is only changed by remove().
+ */
+void MemberTable::clearFlags(Client *client, uint8_t flags) {
+  Record *rec = find(client);
+  if (!rec)
+    return;
+  rec->flags &= ~(flags & ~MEMBER);
+  dropIfUnused(*rec);
+}
+
+bool MemberTable::hasFlags(Client *client, uint8_t flags) const {
+  const Record *rec = find(client);
+  return rec && (rec->flags & flags) == flags;
+}
+
+uint8_t MemberTable::flagsOf(Client *client) const {
+  const Record *rec = find(client);
+  return rec ? rec->flags : 0;
+}
+
+uint32_t MemberTable::tagOf(Client *client) const {
+  const Record *rec = find(client);
+  return rec ? rec->tag : 0;
+}
+
+/**
+ * @brief Sets the owner's tag of an existing record; no-op otherwise.
+ */
+void MemberTable::setTag(Client *client, uint32_t tag) {
+  Record *rec = find(client);
+  if (rec)
+    rec->tag = tag;
+}
+
+/**
+ * @brief Clears status bits on every record, e.g. all pending invites.
+ * Records left without bits are dropped by rebuilding the table once.
+ */
+void MemberTable::clearFlagsEverywhere(uint8_t flags) {
+  flags &= ~MEMBER;
+  for (size_t i = 0; i < _buckets.size(); ++i) {
+    if (_buckets[i].client)
+      _buckets[i].flags &= ~flags;
+  }
+  rehash(_buckets.size());
+}
+
+/* ============================= */
+/*           ITERATION           */
+/* ============================= */
+
+const std::vector<Client *> &MemberTable::members() const { return _members; }
+size_t MemberTable::size() const { return _members.size(); }
+bool MemberTable::empty() const { return _members.empty(); }
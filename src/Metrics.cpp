@@ -0,0 +1,414 @@
+/**
+ * @file Metrics.cpp
+ * @brief Metric types, their registry and the server's metric set.
+ */
+
+#include "../includes/Metrics.hpp"
+#include "../includes/CommandTable.hpp"
+
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+
+uint64_t monotonicNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+/* ============================= */
+/*           HISTOGRAM           */
+/* ============================= */
+
+Histogram::Histogram(int buckets, double scale)
+    : _buckets(buckets < MAX_BUCKETS ? buckets : MAX_BUCKETS), _scale(scale),
+      _count(0), _sum(0) {
+  for (int i = 0; i <= MAX_BUCKETS; ++i)
+    _counts[i].store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Copies a snapshot built elsewhere (same bucket layout), used for
+ * distributions that are recomputed when metrics are read.
+ */
+void Histogram::assign(const Histogram &other) {
+  for (int i = 0; i <= _buckets; ++i)
+    _counts[i].store(other.bucketCount(i), std::memory_order_relaxed);
+  _count.store(other.count(), std::memory_order_relaxed);
+  _sum.store(other.sum(), std::memory_order_relaxed);
+}
+
+uint64_t Histogram::bucketCount(int i) const {
+  return _counts[i].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Upper bound (raw units) of the bucket holding the q-quantile.
+ * Precision is a factor of two; use it for STATS, not for alerting.
+ */
+uint64_t Histogram::percentile(double q) const {
+  uint64_t total = count();
+  if (total == 0)
+    return 0;
+  uint64_t rank = static_cast<uint64_t>(q * (total - 1));
+  uint64_t seen = 0;
+  for (int i = 0; i <= _buckets; ++i) {
+    seen += bucketCount(i);
+    if (seen > rank)
+      return 1ull << i;
+  }
+  return 1ull << _buckets;
+}
+
+/* ============================= */
+/*       LATENCY HISTOGRAM       */
+/* ============================= */
+
+LatencyHistogram::LatencyHistogram() : _sum(0) {
+  for (int i = 0; i < BUCKETS; ++i)
+    _counts[i].store(0, std::memory_order_relaxed);
+}
+
+/* Adds other's samples; the caller is this histogram's only writer */
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+  for (int i = 0; i < BUCKETS; ++i)
+    bump(_counts[i], other._counts[i].load(std::memory_order_relaxed));
+  bump(_sum, other.sum());
+}
+
+uint64_t LatencyHistogram::lowerBound(int i) {
+  if (i < 2 * SUB)
+    return static_cast<uint64_t>(i);
+  int shift = i / SUB - 1;
+  return static_cast<uint64_t>(SUB + i % SUB) << shift;
+}
+
+uint64_t LatencyHistogram::count() const {
+  uint64_t total = 0;
+  for (int i = 0; i < BUCKETS; ++i)
+    total += _counts[i].load(std::memory_order_relaxed);
+  return total;
+}
+
+/**
+ * @brief Midpoint (in ticks) of the bucket holding the q-quantile sample.
+ */
+uint64_t LatencyHistogram::quantile(double q) const {
+  uint64_t total = count();
+  if (total == 0)
+    return 0;
+  uint64_t rank = static_cast<uint64_t>(q * (total - 1));
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKETS; ++i) {
+    seen += _counts[i].load(std::memory_order_relaxed);
+    if (seen > rank) {
+      uint64_t low = lowerBound(i);
+      uint64_t high = i + 1 < BUCKETS ? lowerBound(i + 1) : low;
+      return low + (high - low) / 2;
+    }
+  }
+  return lowerBound(BUCKETS - 1);
+}
+
+/* ============================= */
+/*         LATENCY TABLE         */
+/* ============================= */
+
+std::atomic<int> LatencyTable::_nextSlot(0);
+thread_local LatencyHistogram *LatencyTable::_localShards[MAX_TABLES];
+
+LatencyTable::LatencyTable(size_t series)
+    : _series(series), _slot(_nextSlot.fetch_add(1)) {
+  if (_slot >= MAX_TABLES)
+    throw std::logic_error("too many latency tables");
+}
+
+LatencyTable::~LatencyTable() {
+  for (size_t i = 0; i < _shards.size(); ++i)
+    delete[] _shards[i];
+}
+
+/**
+ * @brief Creates and registers the calling thread's shard.
+ */
+LatencyHistogram *LatencyTable::attach() {
+  LatencyHistogram *shard = new LatencyHistogram[_series];
+  std::lock_guard<std::mutex> guard(_lock);
+  _shards.push_back(shard);
+  _localShards[_slot] = shard;
+  return shard;
+}
+
+void LatencyTable::collect(size_t series, LatencyHistogram &out) const {
+  std::lock_guard<std::mutex> guard(_lock);
+  for (size_t i = 0; i < _shards.size(); ++i)
+    out.merge(_shards[i][series]);
+}
+
+/**
+ * @brief Tick rate, measured over the whole uptime: the first call pins a
+ * (ticks, ns) reference pair, later calls divide by the time since. A
+ * call within 10 ms of the reference spins until 10 ms have passed.
+ */
+double ticksPerNs() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const uint64_t startTicks = cpuTicks();
+  static const uint64_t startNs = monotonicNs();
+  uint64_t ns = monotonicNs();
+  while (ns - startNs < 10000000)
+    ns = monotonicNs();
+  return double(cpuTicks() - startTicks) / double(ns - startNs);
+#else
+  return 1.0;
+#endif
+}
+
+/* ============================= */
+/*           REGISTRY            */
+/* ============================= */
+
+void MetricsRegistry::push(const char *name, const char *help, Kind kind,
+                           const std::string &label, const void *metric,
+                           size_t series) {
+  Entry entry;
+  entry.name = name;
+  entry.help = help;
+  entry.kind = kind;
+  entry.label = label;
+  entry.metric = metric;
+  entry.series = series;
+  _entries.push_back(entry);
+}
+
+void MetricsRegistry::add(const char *name, const char *help,
+                          Counter &counter, const std::string &label) {
+  push(name, help, COUNTER, label, &counter);
+}
+
+void MetricsRegistry::add(const char *name, const char *help, Gauge &gauge,
+                          const std::string &label) {
+  push(name, help, GAUGE, label, &gauge);
+}
+
+void MetricsRegistry::add(const char *name, const char *help,
+                          Histogram &histogram, const std::string &label) {
+  push(name, help, HISTOGRAM, label, &histogram);
+}
+
+void MetricsRegistry::add(const char *name, const char *help,
+                          LatencyTable &table, size_t series,
+                          const std::string &label) {
+  push(name, help, SUMMARY, label, &table, series);
+}
+
+static void appendf(std::string &out, const char *format, const char *name,
+                    const std::string &labels, double value) {
+  char buf[256];
+  int n = std::snprintf(buf, sizeof(buf), format, name,
+                        labels.empty() ? "" : "{", labels.c_str(),
+                        labels.empty() ? "" : "}", value);
+  if (n > 0)
+    out.append(buf, n < static_cast<int>(sizeof(buf)) ? n : sizeof(buf) - 1);
+}
+
+/**
+ * @brief Writes every metric in the Prometheus text exposition format.
+ *
+ * Steps:
+ *  - HELP/TYPE once per family (consecutive entries with the same name)
+ *  - Counters and gauges: one sample each
+ *  - Histograms: cumulative _bucket series with an le label, then _sum
+ *    and _count, scaled to the exported unit
+ *  - Latency series: merged across threads, then summary quantiles, _sum
+ *    and _count in seconds
+ */
+void MetricsRegistry::renderPrometheus(std::string &out) const {
+  static const char *const TYPES[] = {"counter", "gauge", "histogram",
+                                      "summary"};
+  static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+  double secondsPerTick = 1e-9 / ticksPerNs();
+
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    const Entry &e = _entries[i];
+    if (i == 0 || std::string(_entries[i - 1].name) != e.name) {
+      out.append("# HELP ").append(e.name).append(" ").append(e.help);
+      out.append("\n# TYPE ").append(e.name).append(" ");
+      out.append(TYPES[e.kind]).append("\n");
+    }
+
+    if (e.kind == COUNTER) {
+      const Counter *c = static_cast<const Counter *>(e.metric);
+      appendf(out, "%s%s%s%s %.0f\n", e.name, e.label, double(c->value()));
+      continue;
+    }
+    if (e.kind == GAUGE) {
+      const Gauge *g = static_cast<const Gauge *>(e.metric);
+      appendf(out, "%s%s%s%s %.0f\n", e.name, e.label, double(g->value()));
+      continue;
+    }
+    if (e.kind == SUMMARY) {
+      LatencyHistogram merged;
+      static_cast<const LatencyTable *>(e.metric)->collect(e.series, merged);
+      const LatencyHistogram *l = &merged;
+      std::string prefix = e.label.empty() ? "" : e.label + ",";
+      for (size_t q = 0; q < sizeof(QUANTILES) / sizeof(QUANTILES[0]); ++q) {
+        char quantile[64];
+        std::snprintf(quantile, sizeof(quantile), "quantile=\"%g\"",
+                      QUANTILES[q]);
+        appendf(out, "%s%s%s%s %.9g\n", e.name, prefix + quantile,
+                double(l->quantile(QUANTILES[q])) * secondsPerTick);
+      }
+      appendf(out, "%s%s%s%s %.9g\n", (std::string(e.name) + "_sum").c_str(),
+              e.label, double(l->sum()) * secondsPerTick);
+      appendf(out, "%s%s%s%s %.0f\n", (std::string(e.name) + "_count").c_str(),
+              e.label, double(l->count()));
+      continue;
+    }
+
+    const Histogram *h = static_cast<const Histogram *>(e.metric);
+    std::string prefix = e.label.empty() ? "" : e.label + ",";
+    std::string bucket = std::string(e.name) + "_bucket";
+    uint64_t cumulative = 0;
+    for (int b = 0; b <= h->buckets(); ++b) {
+      cumulative += h->bucketCount(b);
+      char le[64];
+      if (b == h->buckets())
+        std::snprintf(le, sizeof(le), "le=\"+Inf\"");
+      else
+        std::snprintf(le, sizeof(le), "le=\"%.9g\"",
+                      double(1ull << b) * h->scale());
+      appendf(out, "%s%s%s%s %.0f\n", bucket.c_str(), prefix + le,
+              double(cumulative));
+    }
+    appendf(out, "%s%s%s%s %.9g\n", (std::string(e.name) + "_sum").c_str(),
+            e.label, double(h->sum()) * h->scale());
+    appendf(out, "%s%s%s%s %.0f\n", (std::string(e.name) + "_count").c_str(),
+            e.label, double(h->count()));
+  }
+}
+
+/**
+ * @brief One STATS line per series: the value, or for histograms the
+ * sample count, mean and bucket-resolution p50/p99 in exported units.
+ * Series that never moved are left out to keep the reply short; latency
+ * histograms have their own report (STATS l).
+ */
+void MetricsRegistry::renderStats(std::vector<std::string> &lines) const {
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    const Entry &e = _entries[i];
+    std::string series = e.name;
+    if (!e.label.empty())
+      series += "{" + e.label + "}";
+
+    char buf[256];
+    if (e.kind == SUMMARY)
+      continue;
+    if (e.kind == COUNTER) {
+      uint64_t v = static_cast<const Counter *>(e.metric)->value();
+      if (v == 0 && !e.label.empty())
+        continue;
+      std::snprintf(buf, sizeof(buf), "%s %llu", series.c_str(),
+                    (unsigned long long)v);
+    } else if (e.kind == GAUGE) {
+      std::snprintf(buf, sizeof(buf), "%s %lld", series.c_str(),
+                    (long long)static_cast<const Gauge *>(e.metric)->value());
+    } else {
+      const Histogram *h = static_cast<const Histogram *>(e.metric);
+      uint64_t n = h->count();
+      double mean = n ? double(h->sum()) / n * h->scale() : 0;
+      std::snprintf(buf, sizeof(buf), "%s count=%llu mean=%.3g p50<=%.3g "
+                    "p99<=%.3g",
+                    series.c_str(), (unsigned long long)n, mean,
+                    double(h->percentile(0.50)) * h->scale(),
+                    double(h->percentile(0.99)) * h->scale());
+    }
+    lines.push_back(buf);
+  }
+}
+
+/* ============================= */
+/*         SERVER METRICS        */
+/* ============================= */
+
+thread_local uint64_t ServerMetrics::queuedLines = 0;
+
+/**
+ * @brief Sets up the histograms' ranges and registers every series.
+ *
+ * Ranges: receive and send calls up to 2^24 bytes, output queue and its
+ * high-water marks up to 2^30 bytes, loop iterations up to 2^34 ns
+ * (~17 s), channel sizes up to 2^20 members.
+ */
+ServerMetrics::ServerMetrics()
+    : recvBytes(24), sendBytes(24), outputQueueBytes(30),
+      loopIterationTime(34, 1e-9), channelMembers(20), sendqPeak(30),
+      latency(MAX_COMMANDS + 1) {
+  MetricsRegistry &r = registry;
+  r.add("ircserv_connections_accepted_total", "Connections accepted.",
+        connectionsAccepted);
+  r.add("ircserv_connections_closed_total", "Connections closed.",
+        connectionsClosed);
+  r.add("ircserv_clients", "Connected clients.", clients);
+
+  size_t commands = CommandTable::size();
+  if (commands > MAX_COMMANDS)
+    commands = MAX_COMMANDS;
+  for (size_t i = 0; i < commands; ++i)
+    r.add("ircserv_messages_in_total", "Command lines received, by command.",
+          messagesIn[i],
+          "command=\"" + std::string(CommandTable::at(i).name) + "\"");
+  r.add("ircserv_messages_in_total", "Command lines received, by command.",
+        unknownCommands, "command=\"unknown\"");
+  for (size_t i = 0; i < commands; ++i)
+    r.add("ircserv_messages_out_total",
+          "Lines queued to clients, by the command that produced them.",
+          messagesOut[i],
+          "command=\"" + std::string(CommandTable::at(i).name) + "\"");
+
+  r.add("ircserv_flood_throttled_total",
+        "Times flood control deferred a client's input.", floodThrottled);
+  r.add("ircserv_flood_disconnects_total",
+        "Clients disconnected for Excess Flood.", floodDisconnects);
+  r.add("ircserv_pings_sent_total", "Keepalive PINGs sent to idle clients.",
+        pingsSent);
+  r.add("ircserv_timeouts_total", "Clients disconnected by a timer.",
+        pingTimeouts, "reason=\"ping\"");
+  r.add("ircserv_timeouts_total", "Clients disconnected by a timer.",
+        registrationTimeouts, "reason=\"registration\"");
+  r.add("ircserv_sendq_disconnects_total",
+        "Clients disconnected for SendQ exceeded.", sendqDisconnects);
+  r.add("ircserv_bytes_received_total", "Bytes read from client sockets.",
+        bytesReceived);
+  r.add("ircserv_bytes_sent_total", "Bytes written to client sockets.",
+        bytesSent);
+  r.add("ircserv_recv_bytes",
+        "Bytes returned by each receive call on a client socket (0: EAGAIN).",
+        recvBytes);
+  r.add("ircserv_send_bytes",
+        "Bytes written by each send call on a client socket (0: EAGAIN).",
+        sendBytes);
+  r.add("ircserv_output_queue_bytes",
+        "Bytes queued for a client at each flush attempt.", outputQueueBytes);
+  r.add("ircserv_loop_iteration_seconds",
+        "Time an event loop spends between wakeup and its next wait.",
+        loopIterationTime);
+  r.add("ircserv_channels", "Existing channels.", channels);
+  r.add("ircserv_channel_members", "Members per channel.", channelMembers);
+  r.add("ircserv_sendq_bytes", "Output bytes queued for all clients.",
+        sendqBytes);
+  r.add("ircserv_client_sendq_peak_bytes",
+        "Send queue high-water mark of each connected client.", sendqPeak);
+
+  for (size_t i = 0; i < commands; ++i)
+    r.add("ircserv_command_seconds",
+          "Handler wall time (state lock held), by command.", latency, i,
+          "command=\"" + std::string(CommandTable::at(i).name) + "\"");
+  r.add("ircserv_dispatch_delay_seconds",
+        "Time from a line being read to its handler starting.",
+        latency, DISPATCH_DELAY);
+}
+
+ServerMetrics &metrics() {
+  static ServerMetrics instance;
+  return instance;
+}
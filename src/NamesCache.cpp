@@ -0,0 +1,149 @@
+/**
+ * @file NamesCache.cpp
+ * @brief Incrementally maintained, pre-chunked NAMES payloads.
+ */
+
+#include "../includes/NamesCache.hpp"
+#include "../includes/Casemap.hpp"
+#include "../includes/Replies.hpp"
+
+#include <memory>
+
+/* RFC 1459: a line is at most 512 bytes including its CRLF */
+static const size_t MAX_LINE = 512;
+
+/**
+ * @brief Sizes chunks for the longest 353 header any member can receive:
+ * ":ircserver 353 <nick> = <channel> :" with a SERVER_NICKLEN nick.
+ */
+NamesCache::NamesCache(const std::string &channel) {
+  size_t header =
+      RPL_NAMREPLY_HEAD.fixedLength + SERVER_NICKLEN + channel.size();
+  _budget = header + 2 < MAX_LINE ? MAX_LINE - 2 - header : 0;
+}
+
+NamesCache::~NamesCache() {}
+
+/* ============================= */
+/*           UPDATES             */
+/* ============================= */
+
+/**
+ * @brief An empty chunk takes any token, so an overlong channel name
+ * still gets one name per line instead of none.
+ */
+bool NamesCache::fits(const Chunk &chunk, std::string_view token) const {
+  if (chunk.text.empty())
+    return true;
+  return chunk.text.size() + 1 + token.size() <= _budget;
+}
+
+/**
+ * @brief Returns the offset of token in text (whole tokens only), or npos.
+ */
+size_t NamesCache::find(const std::string &text, std::string_view token) {
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find(' ', start);
+    if (end == std::string::npos)
+      end = text.size();
+    if (std::string_view(text).substr(start, end - start) == token)
+      return start;
+    start = end + 1;
+  }
+  return std::string::npos;
+}
+
+/**
+ * @brief Adds a member token, preferring the last chunk, then any chunk
+ * with room left by removals, then a new chunk.
+ * @return Index of the chunk that now holds the token.
+ */
+uint32_t NamesCache::add(std::string_view token) {
+  size_t target = _chunks.size();
+  if (!_chunks.empty() && fits(_chunks.back(), token)) {
+    target = _chunks.size() - 1;
+  } else {
+    for (size_t i = 0; i + 1 < _chunks.size(); ++i) {
+      if (fits(_chunks[i], token)) {
+        target = i;
+        break;
+      }
+    }
+  }
+  if (target == _chunks.size())
+    _chunks.push_back(Chunk());
+
+  Chunk &chunk = _chunks[target];
+  if (!chunk.text.empty())
+    chunk.text += ' ';
+  chunk.text.append(token);
+  chunk.cached.reset();
+  return static_cast<uint32_t>(target);
+}
+
+/**
+ * @brief Removes a member token from the chunk add() reported for it.
+ */
+void NamesCache::remove(uint32_t index, std::string_view token) {
+  if (index >= _chunks.size())
+    return;
+  Chunk &chunk = _chunks[index];
+  size_t pos = find(chunk.text, token);
+  if (pos == std::string::npos)
+    return;
+
+  size_t length = token.size();
+  if (pos + length < chunk.text.size())
+    ++length; // the separator after it
+  else if (pos > 0) {
+    --pos; // last token: the separator before it
+    ++length;
+  }
+  chunk.text.erase(pos, length);
+  chunk.cached.reset();
+}
+
+/**
+ * @brief Swaps a member's token (nick change, op change), keeping it in
+ * the same chunk when it still fits.
+ * @return Index of the chunk that now holds the new token.
+ */
+uint32_t NamesCache::replace(uint32_t index, std::string_view oldToken,
+                             std::string_view newToken) {
+  remove(index, oldToken);
+  if (index < _chunks.size() && fits(_chunks[index], newToken)) {
+    Chunk &chunk = _chunks[index];
+    if (!chunk.text.empty())
+      chunk.text += ' ';
+    chunk.text.append(newToken);
+    chunk.cached.reset();
+    return index;
+  }
+  return add(newToken);
+}
+
+/* ============================= */
+/*            OUTPUT             */
+/* ============================= */
+
+/**
+ * @brief Appends the cached payload line of every non-empty chunk,
+ * rebuilding only the chunks changed since the last call.
+ */
+void NamesCache::collect(std::vector<SharedLine> &lines) {
+  for (size_t i = 0; i < _chunks.size(); ++i) {
+    Chunk &chunk = _chunks[i];
+    if (chunk.text.empty())
+      continue;
+    if (!chunk.cached) {
+      std::shared_ptr<std::string> line = std::make_shared<std::string>();
+      line->reserve(chunk.text.size() + 2);
+      line->append(chunk.text).append("\r\n");
+      chunk.cached = line;
+    }
+    lines.push_back(chunk.cached);
+  }
+}
+
+size_t NamesCache::chunkCount() const { return _chunks.size(); }
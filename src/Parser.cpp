@@ -11,33 +11,54 @@
 /* ************************************************************************** */
 
 #include "../includes/Parser.hpp"
-#include <sstream>
 
 /* ============================= */
 /*         IRC CMD PARSER        */
 /* ============================= */
 
-ParsedCommand Parser::parse(const std::string &line) {
+/**
+ * @brief Returns the token starting at pos and moves pos past it and the
+ * spaces that follow.
+ */
+static std::string_view nextToken(std::string_view line, size_t &pos) {
+  size_t end = line.find(' ', pos);
+  if (end == std::string_view::npos)
+    end = line.size();
+  std::string_view token = line.substr(pos, end - pos);
+  pos = line.find_first_not_of(' ', end);
+  if (pos == std::string_view::npos)
+    pos = line.size();
+  return token;
+}
+
+ParsedCommand Parser::parse(std::string_view line) {
   ParsedCommand result;
-  std::istringstream iss(line);
-  std::string token;
-  bool trailingFound = false;
+  size_t pos = line.find_first_not_of(' ');
+  if (pos == std::string_view::npos)
+    return result;
 
-  while (iss >> token) {
-    if (!trailingFound && token.size() > 0 && token[0] == ':') {
-      trailingFound = true;
-      result.trailing = token.substr(1);
+  if (line[pos] == '@') {
+    result.tags = nextToken(line, ++pos);
+    if (pos == line.size())
+      return result;
+  }
+  if (line[pos] == ':') {
+    result.prefix = nextToken(line, ++pos);
+    if (pos == line.size())
+      return result;
+  }
+  result.command = nextToken(line, pos);
 
-      std::string rest;
-      std::getline(iss, rest);
-      if (!rest.empty() && rest[0] == ' ')
-        rest.erase(0, 1);
-      result.trailing += (rest.empty() ? "" : " " + rest);
-    } else if (result.command.empty()) {
-      result.command = token;
-    } else if (!trailingFound) {
-      result.params.push_back(token);
+  while (pos < line.size()) {
+    if (line[pos] == ':') {
+      result.trailing = line.substr(pos + 1);
+      break;
+    }
+    if (result.params.size() == ParamList::MAX_PARAMS - 1) {
+      result.trailing = line.substr(pos); // 15th parameter takes the rest
+      break;
     }
+    result.params.push_back(nextToken(line, pos));
   }
   return result;
 }
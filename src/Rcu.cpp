@@ -0,0 +1,118 @@
+/**
+ * @file Rcu.cpp
+ * @brief Epochs, reader slots and the deferred frees behind them.
+ */
+
+#include "../includes/Rcu.hpp"
+
+#include <algorithm>
+
+Rcu::Rcu() : _epoch(1) {}
+
+Rcu::~Rcu() { drain(); }
+
+/* ============================= */
+/*            READERS            */
+/* ============================= */
+
+/**
+ * @brief Adds a reactor thread to the readers writers wait for, online.
+ * Called by the thread itself before its first lock-free read.
+ */
+void Rcu::registerReader(Reader &reader) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _readers.push_back(&reader);
+  online(reader);
+}
+
+void Rcu::unregisterReader(Reader &reader) {
+  offline(reader);
+  std::lock_guard<std::mutex> lock(_mutex);
+  _readers.erase(std::find(_readers.begin(), _readers.end(), &reader));
+}
+
+/**
+ * @brief Marks a quiescent state: nothing loaded before this call is used
+ * after it.
+ *
+ * The acquire load pairs with the epoch increment in retire(), so a
+ * reader that records epoch e sees everything published before e. The
+ * fence orders the store before the reader's next loads, against the one
+ * in retire(): either the writer sees this epoch, or the reader sees the
+ * new version.
+ */
+void Rcu::online(Reader &reader) {
+  reader.seen.store(_epoch.load(std::memory_order_acquire),
+                    std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+/**
+ * @brief The reader holds no reference until its next online().
+ */
+void Rcu::offline(Reader &reader) {
+  reader.seen.store(0, std::memory_order_release);
+}
+
+/* ============================= */
+/*            WRITERS            */
+/* ============================= */
+
+/**
+ * @brief Defers a free until no reader can still see the object, then
+ * runs whatever deleters have become safe.
+ *
+ * Steps:
+ *  - Tag the deleter with a new epoch; the object is already unpublished
+ *  - Find the oldest epoch an online reader has seen (none online: every
+ *    deleter is safe)
+ *  - Run, oldest first and outside the mutex, the deleters whose epoch is
+ *    not newer than that
+ *
+ * Called under the writers' lock (Server::_stateLock, exclusive), which
+ * is where the deleters run too: they may touch writer-owned state such
+ * as the channel pool.
+ */
+void Rcu::retire(std::function<void()> deleter) {
+  std::vector<std::function<void()> > ready;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Retired entry;
+    entry.epoch = _epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+    entry.deleter = deleter;
+    _retired.push_back(entry);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < _readers.size(); ++i) {
+      uint64_t seen = _readers[i]->seen.load(std::memory_order_acquire);
+      if (seen && seen < oldest)
+        oldest = seen;
+    }
+    while (!_retired.empty() && _retired.front().epoch <= oldest) {
+      ready.push_back(_retired.front().deleter);
+      _retired.pop_front();
+    }
+  }
+  for (size_t i = 0; i < ready.size(); ++i)
+    ready[i]();
+}
+
+/**
+ * @brief Runs every pending deleter. Only once no reader is running
+ * (shutdown, after the reactors are joined).
+ */
+void Rcu::drain() {
+  std::deque<Retired> all;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    all.swap(_retired);
+  }
+  for (size_t i = 0; i < all.size(); ++i)
+    all[i].deleter();
+}
+
+Rcu &rcu() {
+  static Rcu instance;
+  return instance;
+}
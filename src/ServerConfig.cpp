@@ -0,0 +1,168 @@
+/**
+ * @file ServerConfig.cpp
+ * @brief Parsing of optional "--name=value" startup flags.
+ */
+
+#include "../includes/ServerConfig.hpp"
+#include "../includes/InputBuffer.hpp"
+
+#include <cstdlib>
+#include <sys/socket.h>
+#include <thread>
+
+/* Upper bound for --threads: a few reactors per core, or a fixed cap when
+ * the core count is unknown */
+static const long THREADS_PER_CORE = 4;
+static const long MAX_THREADS_UNKNOWN = 256;
+
+/* Limits for --flood-*. The deferred input must leave room for one more
+ * full IRC line in the client's input buffer, or the hard limit would
+ * never be reached */
+static const long MAX_FLOOD_TOKENS = 1000000;
+static const long MIN_FLOOD_QUEUE = 512;
+static const long MAX_FLOOD_QUEUE = InputBuffer::CAPACITY - 1024;
+
+/* Upper bound for the --*-timeout and --ping-interval seconds (one day) */
+static const long MAX_TIMEOUT = 86400;
+
+/* Bounds of the listener options; socket buffers up to 64 MB */
+static const long MAX_BACKLOG = 65535;
+static const long MAX_SOCKET_BUFFER = 64L << 20;
+static const long MAX_ACCEPT_BUDGET = 65536;
+
+/* Bounds of --read-budget: at least one small read, at most 16 MB */
+static const long MIN_READ_BUDGET = 512;
+static const long MAX_READ_BUDGET = 16L << 20;
+
+/* Bounds of --sendq and --sendq-unregistered: room for a welcome burst,
+ * at most 1 GB; --sendq-total up to 64 GB */
+static const long MIN_SENDQ = 4096;
+static const long MAX_SENDQ = 1L << 30;
+static const long MAX_SENDQ_TOTAL = 64L << 30;
+
+/* Upper bound for --reserve-*, a few hundred MB of preallocated objects */
+static const long MAX_RESERVE = 1000000;
+
+ServerConfig::ServerConfig()
+    : eventBackend("epoll"), threads(1), reserveClients(0),
+      reserveChannels(0), metricsPort(0), floodRate(10), floodBurst(20),
+      floodQueue(4096), pingInterval(120), pingTimeout(60),
+      registrationTimeout(30), listenBacklog(SOMAXCONN), deferAccept(0),
+      tcpNoDelay(true), sendBuffer(0), recvBuffer(0), acceptBudget(64),
+      readBudget(16384), sendQueue(1 << 20), sendQueueUnregistered(65536),
+      sendQueueTotal(1L << 30), logConnections(true) {}
+
+/* Parses a whole decimal value within [min, max] */
+static bool parseLong(const std::string &value, long min, long max,
+                      long &out) {
+  char *end = NULL;
+  long n = std::strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0' || n < min || n > max)
+    return false;
+  out = n;
+  return true;
+}
+
+bool ServerConfig::applyFlag(const std::string &flag) {
+  size_t eq = flag.find('=');
+  if (flag.compare(0, 2, "--") != 0 || eq == std::string::npos)
+    return false;
+
+  std::string name = flag.substr(2, eq - 2);
+  std::string value = flag.substr(eq + 1);
+
+  if (name == "oper-password") {
+    if (value.empty())
+      return false;
+    operPassword = value;
+    return true;
+  }
+  if (name == "event-backend") {
+    if (value != "uring" && value != "epoll" && value != "poll")
+      return false;
+    eventBackend = value;
+    return true;
+  }
+  long n;
+  if (name == "threads") {
+    long cores = static_cast<long>(std::thread::hardware_concurrency());
+    long max = cores ? cores * THREADS_PER_CORE : MAX_THREADS_UNKNOWN;
+    if (!parseLong(value, 1, max, n))
+      return false;
+    threads = static_cast<int>(n);
+    return true;
+  }
+  if ((name == "reserve-clients" || name == "reserve-channels") &&
+      parseLong(value, 0, MAX_RESERVE, n)) {
+    (name == "reserve-clients" ? reserveClients : reserveChannels) = n;
+    return true;
+  }
+  if (name == "metrics-port" && parseLong(value, 1, 65535, n)) {
+    metricsPort = static_cast<int>(n);
+    return true;
+  }
+  if (name == "flood-rate" && parseLong(value, 0, MAX_FLOOD_TOKENS, n)) {
+    floodRate = static_cast<unsigned>(n);
+    return true;
+  }
+  if (name == "flood-burst" && parseLong(value, 1, MAX_FLOOD_TOKENS, n)) {
+    floodBurst = static_cast<unsigned>(n);
+    return true;
+  }
+  if (name == "flood-queue" &&
+      parseLong(value, MIN_FLOOD_QUEUE, MAX_FLOOD_QUEUE, n)) {
+    floodQueue = static_cast<size_t>(n);
+    return true;
+  }
+  if (name == "ping-interval" && parseLong(value, 0, MAX_TIMEOUT, n)) {
+    pingInterval = static_cast<unsigned>(n);
+    return true;
+  }
+  if (name == "ping-timeout" && parseLong(value, 1, MAX_TIMEOUT, n)) {
+    pingTimeout = static_cast<unsigned>(n);
+    return true;
+  }
+  if (name == "registration-timeout" &&
+      parseLong(value, 0, MAX_TIMEOUT, n)) {
+    registrationTimeout = static_cast<unsigned>(n);
+    return true;
+  }
+  if (name == "backlog" && parseLong(value, 1, MAX_BACKLOG, n)) {
+    listenBacklog = static_cast<int>(n);
+    return true;
+  }
+  if (name == "defer-accept" && parseLong(value, 0, MAX_TIMEOUT, n)) {
+    deferAccept = static_cast<int>(n);
+    return true;
+  }
+  if ((name == "sndbuf" || name == "rcvbuf") &&
+      parseLong(value, 0, MAX_SOCKET_BUFFER, n)) {
+    (name == "sndbuf" ? sendBuffer : recvBuffer) = static_cast<int>(n);
+    return true;
+  }
+  if (name == "accept-budget" && parseLong(value, 1, MAX_ACCEPT_BUDGET, n)) {
+    acceptBudget = static_cast<int>(n);
+    return true;
+  }
+  if (name == "read-budget" &&
+      parseLong(value, MIN_READ_BUDGET, MAX_READ_BUDGET, n)) {
+    readBudget = static_cast<size_t>(n);
+    return true;
+  }
+  if ((name == "sendq" || name == "sendq-unregistered") &&
+      parseLong(value, MIN_SENDQ, MAX_SENDQ, n)) {
+    (name == "sendq" ? sendQueue : sendQueueUnregistered) =
+        static_cast<size_t>(n);
+    return true;
+  }
+  if (name == "sendq-total" && parseLong(value, 0, MAX_SENDQ_TOTAL, n)) {
+    sendQueueTotal = static_cast<size_t>(n);
+    return true;
+  }
+  if ((name == "tcp-nodelay" || name == "log-connections") &&
+      parseLong(value, 0, 1, n)) {
+    (name == "tcp-nodelay" ? tcpNoDelay : logConnections) = n != 0;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file TimerWheel.cpp
+ * @brief Hierarchical timing wheel: O(1) schedule/cancel, cascading expiry.
+ */
+
+#include "../includes/TimerWheel.hpp"
+
+static const uint64_t SLOT_MASK = TimerWheel::SLOTS - 1;
+
+/* Ticks covered by the whole wheel; later deadlines are clamped to it */
+static const uint64_t HORIZON = 1ull
+                                << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS);
+
+/* ============================= */
+/*             TIMER             */
+/* ============================= */
+
+void TimerWheel::Timer::unlink() {
+  if (!_prev)
+    return;
+  _prev->_next = _next;
+  _next->_prev = _prev;
+  _prev = _next = NULL;
+}
+
+/* ============================= */
+/*          CONSTRUCTION         */
+/* ============================= */
+
+TimerWheel::TimerWheel(uint64_t tickNs, uint64_t nowNs)
+    : _tickNs(tickNs), _originNs(nowNs), _current(0) {
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot) {
+      Timer &head = _slots[level][slot];
+      head._prev = head._next = &head;
+    }
+  }
+  _expired._prev = _expired._next = &_expired;
+}
+
+/**
+ * @brief Leaves every timer still scheduled unlinked, so owners that
+ * outlive the wheel do not touch it again.
+ */
+TimerWheel::~TimerWheel() {
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot)
+      detachAll(_slots[level][slot]);
+  }
+  detachAll(_expired);
+}
+
+/* ============================= */
+/*          SCHEDULING           */
+/* ============================= */
+
+/**
+ * @brief (Re)arms a timer to fire at the first tick at or after atNs.
+ * Deadlines in the past fire on the next advance().
+ */
+void TimerWheel::schedule(Timer &timer, uint64_t atNs) {
+  timer.unlink();
+  uint64_t tick =
+      atNs > _originNs ? (atNs - _originNs + _tickNs - 1) / _tickNs : 0;
+  if (tick <= _current)
+    tick = _current + 1;
+  if (tick - _current >= HORIZON)
+    tick = _current + HORIZON - 1;
+  timer._expires = tick;
+  place(timer);
+}
+
+/**
+ * @brief Links a timer into the coarsest level whose slots still tell its
+ * tick apart from the current one.
+ */
+void TimerWheel::place(Timer &timer) {
+  uint64_t delta = timer._expires - _current;
+  int level = 0;
+  while (level < LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1))))
+    ++level;
+  append(_slots[level][(timer._expires >> (SLOT_BITS * level)) & SLOT_MASK],
+         timer);
+}
+
+void TimerWheel::append(Timer &head, Timer &timer) {
+  timer._prev = head._prev;
+  timer._next = &head;
+  head._prev->_next = &timer;
+  head._prev = &timer;
+}
+
+void TimerWheel::detachAll(Timer &head) {
+  while (!emptyList(head))
+    head._next->unlink();
+}
+
+/* ============================= */
+/*            EXPIRY             */
+/* ============================= */
+
+/**
+ * @brief Processes every tick up to nowNs: cascades wrapped levels and
+ * moves due timers to the expired list.
+ *
+ * An empty wheel jumps straight to the current tick, so a long idle wait
+ * costs nothing.
+ */
+void TimerWheel::advance(uint64_t nowNs) {
+  if (nowNs < _originNs)
+    return;
+  uint64_t target = (nowNs - _originNs) / _tickNs;
+  if (target > _current + SLOTS && idle()) {
+    _current = target;
+    return;
+  }
+
+  while (_current < target) {
+    ++_current;
+    if ((_current & SLOT_MASK) == 0) {
+      for (int level = 1; level < LEVELS; ++level) {
+        cascade(level);
+        if (((_current >> (SLOT_BITS * level)) & SLOT_MASK) != 0)
+          break;
+      }
+    }
+    expireSlot(_slots[0][_current & SLOT_MASK]);
+  }
+}
+
+/* Moves the timers of a level's current slot down to finer levels */
+void TimerWheel::cascade(int level) {
+  Timer &head = _slots[level][(_current >> (SLOT_BITS * level)) & SLOT_MASK];
+  while (!emptyList(head)) {
+    Timer *timer = head._next;
+    timer->unlink();
+    place(*timer);
+  }
+}
+
+void TimerWheel::expireSlot(Timer &head) {
+  while (!emptyList(head)) {
+    Timer *timer = head._next;
+    timer->unlink();
+    append(_expired, *timer);
+  }
+}
+
+/**
+ * @brief Pops one due timer, NULL when none is left. The timer is no
+ * longer pending, so the caller may schedule it again.
+ */
+TimerWheel::Timer *TimerWheel::nextExpired() {
+  if (emptyList(_expired))
+    return NULL;
+  Timer *timer = _expired._next;
+  timer->unlink();
+  return timer;
+}
+
+bool TimerWheel::idle() const {
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot) {
+      if (!emptyList(_slots[level][slot]))
+        return false;
+    }
+  }
+  return emptyList(_expired);
+}
+
+/**
+ * @brief Milliseconds until advance() has work to do: the next occupied
+ * tick of the finest level, or the next cascade when only coarser levels
+ * hold timers; -1 when the wheel is empty.
+ *
+ * Scans at most SLOTS heads; the event loop uses it as its wait timeout.
+ */
+int TimerWheel::timeoutMs(uint64_t nowNs) const {
+  if (!emptyList(_expired))
+    return 0;
+
+  uint64_t due = 0;
+  for (uint64_t tick = _current + 1; tick <= _current + SLOTS; ++tick) {
+    if (!emptyList(_slots[0][tick & SLOT_MASK]) ||
+        ((tick & SLOT_MASK) == 0 && !idle())) {
+      due = tick;
+      break;
+    }
+  }
+  if (!due)
+    return -1;
+
+  uint64_t dueNs = _originNs + due * _tickNs;
+  if (dueNs <= nowNs)
+    return 0;
+  return static_cast<int>((dueNs - nowNs + 999999) / 1000000);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file EpollEventLoop.cpp
+ * @brief Edge-triggered epoll backend for the server event loop.
+ */
+
+#include "../../includes/EpollEventLoop.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+/* Upper bound of events fetched by a single epoll_wait() call */
+static const int MAX_READY_EVENTS = 1024;
+
+EpollEventLoop::EpollEventLoop()
+    : _epollFd(epoll_create1(EPOLL_CLOEXEC)), _ready(MAX_READY_EVENTS) {
+  if (_epollFd < 0)
+    throw std::runtime_error("epoll_create1() failed");
+}
+
+EpollEventLoop::~EpollEventLoop() {
+  if (_epollFd != -1)
+    close(_epollFd);
+}
+
+/**
+ * @brief Registers an fd for edge-triggered read notifications.
+ */
+void EpollEventLoop::add(int fd) {
+  epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  ev.data.fd = fd;
+  if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    throw std::runtime_error("epoll_ctl(ADD) failed");
+
+  if (static_cast<size_t>(fd) >= _armed.size())
+    _armed.resize(fd + 1, 0);
+  _armed[fd] = 0;
+}
+
+/**
+ * @brief Unregisters an fd. Must happen before close() so a reused fd
+ * number never inherits a stale registration.
+ */
+void EpollEventLoop::remove(int fd) {
+  epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, NULL);
+  if (static_cast<size_t>(fd) < _armed.size())
+    _armed[fd] = 0;
+}
+
+/**
+ * @brief Arms or disarms EPOLLOUT. Skips the syscall when the requested
+ * state is already the registered one.
+ */
+void EpollEventLoop::setWritable(int fd, bool enable) {
+  if (fd < 0 || static_cast<size_t>(fd) >= _armed.size())
+    return;
+  if ((_armed[fd] != 0) == enable)
+    return;
+
+  epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  if (enable)
+    ev.events |= EPOLLOUT;
+  ev.data.fd = fd;
+  if (epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev) == 0)
+    _armed[fd] = enable ? 1 : 0;
+}
+
+/**
+ * @brief Waits for activity; cost depends only on the number of ready fds.
+ */
+int EpollEventLoop::wait(std::vector<IoEvent> &events, int timeoutMs) {
+  events.clear();
+  int n = epoll_wait(_epollFd, _ready.data(), static_cast<int>(_ready.size()),
+                     timeoutMs);
+  if (n < 0) {
+    if (errno == EINTR)
+      return 0;
+    throw std::runtime_error("epoll_wait() failed");
+  }
+
+  for (int i = 0; i < n; ++i) {
+    unsigned int re = _ready[i].events;
+    IoEvent ev(_ready[i].data.fd);
+    ev.readable = (re & (EPOLLIN | EPOLLRDHUP)) != 0;
+    ev.writable = (re & EPOLLOUT) != 0;
+    ev.error = (re & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0;
+    events.push_back(ev);
+  }
+  return n;
+}
+
+bool EpollEventLoop::isEdgeTriggered() const { return true; }
+
+const char *EpollEventLoop::name() const { return "epoll"; }
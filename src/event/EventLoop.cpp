@@ -0,0 +1,34 @@
+#include "../../includes/EventLoop.hpp"
+#include "../../includes/EpollEventLoop.hpp"
+#include "../../includes/IoUringEventLoop.hpp"
+#include "../../includes/PollEventLoop.hpp"
+
+#include <stdexcept>
+
+/**
+ * @brief Builds the requested backend.
+ *
+ * io_uring is probed at runtime (kernel support, seccomp, sysctl
+ * io_uring_disabled); when it is unavailable we fall back to epoll, and
+ * from epoll to poll().
+ */
+EventLoop *EventLoop::create(const std::string &backend) {
+  if (backend == "poll")
+    return new PollEventLoop();
+  if (backend != "epoll" && backend != "uring")
+    throw std::runtime_error("unknown event backend: " + backend);
+
+  if (backend == "uring") {
+    try {
+      return new IoUringEventLoop();
+    } catch (const std::exception &) {
+      // not supported here, use epoll
+    }
+  }
+
+  try {
+    return new EpollEventLoop();
+  } catch (const std::exception &) {
+    return new PollEventLoop();
+  }
+}
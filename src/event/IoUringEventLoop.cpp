@@ -0,0 +1,534 @@
+/**
+ * @file IoUringEventLoop.cpp
+ * @brief io_uring backend: multishot accept, multishot recv with provided
+ *        buffers and scatter-gather sends, one io_uring_enter per loop
+ *        iteration.
+ */
+
+#include "../../includes/IoUringEventLoop.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Ring sizes; the CQ is larger because multishot requests post many CQEs */
+static const unsigned SQ_ENTRIES = 4096;
+static const unsigned CQ_ENTRIES = 16384;
+
+/* Provided buffers shared by every connection of one loop */
+static const unsigned BUFFER_COUNT = 1024; // must be a power of two
+static const unsigned BUFFER_SIZE = 4096;
+static const unsigned BUFFER_GROUP = 0;
+
+/* Request kinds stored in the top byte of user_data */
+enum { OP_ACCEPT = 1, OP_RECV, OP_POLL, OP_SEND, OP_CANCEL };
+
+/* ============================= */
+/*           SYSCALLS            */
+/* ============================= */
+
+static int uringSetup(unsigned entries, io_uring_params *p) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                      unsigned flags, void *arg, size_t argSize) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit,
+                                  minComplete, flags, arg, argSize));
+}
+
+static int uringRegister(int fd, unsigned opcode, void *arg, unsigned count) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+/**
+ * @brief user_data layout: [kind:8][generation:24][fd:32]
+ */
+static uint64_t tag(int kind, uint32_t gen, int fd) {
+  return (static_cast<uint64_t>(kind) << 56) |
+         (static_cast<uint64_t>(gen & 0xffffff) << 32) |
+         static_cast<uint32_t>(fd);
+}
+
+/* ============================= */
+/*          CONSTRUCTION         */
+/* ============================= */
+
+IoUringEventLoop::IoUringEventLoop()
+    : _ringFd(-1), _pending(0), _sqMap(MAP_FAILED), _sqMapSize(0),
+      _sqHead(NULL), _sqTail(NULL), _sqMask(0), _sqEntries(0), _sqArray(NULL),
+      _sqes(static_cast<io_uring_sqe *>(MAP_FAILED)), _sqesSize(0),
+      _cqMap(MAP_FAILED), _cqMapSize(0), _cqHead(NULL), _cqTail(NULL),
+      _cqMask(0), _cqes(NULL),
+      _bufRing(static_cast<io_uring_buf_ring *>(MAP_FAILED)),
+      _bufRingSize(0), _bufTail(0), _bufBase(NULL) {
+  try {
+    setup();
+  } catch (...) {
+    teardown();
+    throw;
+  }
+}
+
+IoUringEventLoop::~IoUringEventLoop() { teardown(); }
+
+/**
+ * @brief Creates the ring and checks every feature this backend needs.
+ *
+ * Steps:
+ *  - io_uring_setup (fails with ENOSYS / EPERM when io_uring is disabled)
+ *  - Require NODROP and EXT_ARG (wait timeouts without a timeout SQE)
+ *  - Probe opcodes; SEND_ZC shipped in the same release (6.0) as
+ *    multishot recv, so it doubles as the check for that
+ *  - Map the SQ / CQ rings and the SQE array
+ *  - Register the provided-buffer ring and fill it
+ */
+void IoUringEventLoop::setup() {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = CQ_ENTRIES;
+
+  _ringFd = uringSetup(SQ_ENTRIES, &params);
+  if (_ringFd < 0)
+    throw std::runtime_error("io_uring_setup() failed");
+
+  if (!(params.features & IORING_FEAT_NODROP) ||
+      !(params.features & IORING_FEAT_EXT_ARG))
+    throw std::runtime_error("io_uring: kernel too old");
+
+  std::vector<char> probeMem(sizeof(io_uring_probe) +
+                             256 * sizeof(io_uring_probe_op));
+  io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(&probeMem[0]);
+  if (uringRegister(_ringFd, IORING_REGISTER_PROBE, probe, 256) < 0)
+    throw std::runtime_error("io_uring: probe failed");
+  const int needed[] = {IORING_OP_ACCEPT, IORING_OP_RECV,
+                        IORING_OP_SENDMSG, IORING_OP_POLL_ADD,
+                        IORING_OP_ASYNC_CANCEL, IORING_OP_SEND_ZC};
+  for (size_t i = 0; i < sizeof(needed) / sizeof(needed[0]); ++i) {
+    if (needed[i] > probe->last_op ||
+        !(probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED))
+      throw std::runtime_error("io_uring: missing opcode");
+  }
+
+  _sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  _cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (_cqMapSize > _sqMapSize)
+      _sqMapSize = _cqMapSize;
+    _cqMapSize = 0;
+  }
+
+  _sqMap = mmap(NULL, _sqMapSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+  if (_sqMap == MAP_FAILED)
+    throw std::runtime_error("io_uring: mmap(SQ) failed");
+  if (_cqMapSize) {
+    _cqMap = mmap(NULL, _cqMapSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+    if (_cqMap == MAP_FAILED)
+      throw std::runtime_error("io_uring: mmap(CQ) failed");
+  }
+  char *sq = static_cast<char *>(_sqMap);
+  char *cq = _cqMapSize ? static_cast<char *>(_cqMap) : sq;
+
+  _sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  _sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  _sqEntries = params.sq_entries;
+  _sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+  _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  _sqes = static_cast<io_uring_sqe *>(
+      mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+           _ringFd, IORING_OFF_SQES));
+  if (_sqes == MAP_FAILED)
+    throw std::runtime_error("io_uring: mmap(SQEs) failed");
+
+  _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  _cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  _cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  _bufRingSize = BUFFER_COUNT * sizeof(io_uring_buf);
+  _bufRing = static_cast<io_uring_buf_ring *>(
+      mmap(NULL, _bufRingSize, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (_bufRing == MAP_FAILED)
+    throw std::runtime_error("io_uring: mmap(buffer ring) failed");
+
+  io_uring_buf_reg reg;
+  std::memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(_bufRing);
+  reg.ring_entries = BUFFER_COUNT;
+  reg.bgid = BUFFER_GROUP;
+  if (uringRegister(_ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    throw std::runtime_error("io_uring: provided buffer ring unsupported");
+
+  _bufBase = new char[BUFFER_COUNT * BUFFER_SIZE];
+  for (unsigned i = 0; i < BUFFER_COUNT; ++i)
+    provideBuffer(static_cast<uint16_t>(i));
+  publishBuffers();
+}
+
+/**
+ * @brief Releases whatever setup() managed to create. Closing the ring fd
+ * cancels every request still in flight.
+ */
+void IoUringEventLoop::teardown() {
+  if (_ringFd != -1)
+    close(_ringFd);
+  _ringFd = -1;
+  if (_sqes != MAP_FAILED)
+    munmap(_sqes, _sqesSize);
+  _sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+  if (_cqMap != MAP_FAILED)
+    munmap(_cqMap, _cqMapSize);
+  _cqMap = MAP_FAILED;
+  if (_sqMap != MAP_FAILED)
+    munmap(_sqMap, _sqMapSize);
+  _sqMap = MAP_FAILED;
+  if (_bufRing != MAP_FAILED)
+    munmap(_bufRing, _bufRingSize);
+  _bufRing = static_cast<io_uring_buf_ring *>(MAP_FAILED);
+  delete[] _bufBase;
+  _bufBase = NULL;
+}
+
+/* ============================= */
+/*        SUBMISSION QUEUE       */
+/* ============================= */
+
+IoUringEventLoop::Slot &IoUringEventLoop::slot(int fd) {
+  if (static_cast<size_t>(fd) >= _slots.size())
+    _slots.resize(fd + 1);
+  return _slots[fd];
+}
+
+/**
+ * @brief Returns a zeroed SQE. Nothing reaches the kernel until wait()
+ * (or a full ring) calls io_uring_enter.
+ */
+io_uring_sqe *IoUringEventLoop::nextSqe() {
+  unsigned tail = *_sqTail;
+  if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries) {
+    int n = uringEnter(_ringFd, _pending, 0, 0, NULL, 0);
+    if (n > 0)
+      _pending -= static_cast<unsigned>(n) < _pending ? n : _pending;
+    if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries)
+      throw std::runtime_error("io_uring: submission queue full");
+  }
+
+  unsigned index = tail & _sqMask;
+  io_uring_sqe *sqe = &_sqes[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  _sqArray[index] = index;
+  // no SQPOLL thread: the kernel only reads the ring inside io_uring_enter
+  __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+  ++_pending;
+  return sqe;
+}
+
+void IoUringEventLoop::armAccept(int fd) {
+  io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->user_data = tag(OP_ACCEPT, _slots[fd].gen, fd);
+}
+
+void IoUringEventLoop::armRecv(int fd) {
+  io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = BUFFER_GROUP;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->user_data = tag(OP_RECV, _slots[fd].gen, fd);
+}
+
+void IoUringEventLoop::armPoll(int fd) {
+  io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = tag(OP_POLL, _slots[fd].gen, fd);
+}
+
+/**
+ * @brief Cancels a request by its user_data. Keyed on user_data rather
+ * than fd so a late submission can never hit a reused fd number.
+ */
+void IoUringEventLoop::cancel(uint64_t userData) {
+  io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = userData;
+  sqe->user_data = tag(OP_CANCEL, 0, 0);
+}
+
+/* ============================= */
+/*        PROVIDED BUFFERS       */
+/* ============================= */
+
+void IoUringEventLoop::provideBuffer(uint16_t bid) {
+  // not _bufRing->bufs: in C++ the header's flex-array wrapper shifts it
+  // by 8 bytes, while the kernel expects entry 0 at offset 0
+  io_uring_buf *ring = reinterpret_cast<io_uring_buf *>(_bufRing);
+  io_uring_buf *buf = &ring[_bufTail & (BUFFER_COUNT - 1)];
+  buf->addr = reinterpret_cast<uint64_t>(_bufBase + bid * BUFFER_SIZE);
+  buf->len = BUFFER_SIZE;
+  buf->bid = bid;
+  ++_bufTail;
+}
+
+void IoUringEventLoop::publishBuffers() {
+  __atomic_store_n(&_bufRing->tail, _bufTail, __ATOMIC_RELEASE);
+}
+
+/* ============================= */
+/*          REGISTRATION         */
+/* ============================= */
+
+/**
+ * @brief Starts the right multishot request for the kind of fd.
+ *
+ * Listening sockets (SO_ACCEPTCONN) get accept, other sockets recv, and
+ * anything that is not a socket (the reactor eventfd) a readiness poll.
+ */
+void IoUringEventLoop::add(int fd) {
+  Slot &s = slot(fd);
+  s.send.reset();
+
+  int listening = 0;
+  socklen_t len = sizeof(listening);
+  if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0) {
+    s.kind = POLLED;
+    armPoll(fd);
+  } else if (listening) {
+    s.kind = LISTENER;
+    armAccept(fd);
+  } else {
+    s.kind = CONNECTION;
+    armRecv(fd);
+  }
+}
+
+/**
+ * @brief Cancels everything outstanding on fd and retires its generation.
+ *
+ * A send still in flight keeps its lines in _orphans until the kernel
+ * reports its completion.
+ */
+void IoUringEventLoop::remove(int fd) {
+  if (fd < 0 || static_cast<size_t>(fd) >= _slots.size())
+    return;
+  Slot &s = _slots[fd];
+  if (s.kind == NONE)
+    return;
+
+  if (s.kind == LISTENER)
+    cancel(tag(OP_ACCEPT, s.gen, fd));
+  else if (s.kind == CONNECTION)
+    cancel(tag(OP_RECV, s.gen, fd));
+  else
+    cancel(tag(OP_POLL, s.gen, fd));
+
+  if (s.send) {
+    uint64_t userData = tag(OP_SEND, s.gen, fd);
+    _orphans[userData] = std::move(s.send);
+    cancel(userData);
+  }
+  s.kind = NONE;
+  ++s.gen;
+}
+
+/**
+ * @brief No readiness to arm: output is pushed with submitSend().
+ */
+void IoUringEventLoop::setWritable(int fd, bool enable) {
+  (void)fd;
+  (void)enable;
+}
+
+bool IoUringEventLoop::sendInFlight(int fd) const {
+  return fd >= 0 && static_cast<size_t>(fd) < _slots.size() &&
+         _slots[fd].send;
+}
+
+/**
+ * @brief Queues one SENDMSG covering up to IOV_MAX queued lines; it goes
+ * out with the next io_uring_enter. The completion is reported as a
+ * writable event with sent = bytes written.
+ */
+void IoUringEventLoop::submitSend(int fd, const OutputQueue &queue) {
+  Slot &s = slot(fd);
+  if (s.kind != CONNECTION || s.send || queue.empty())
+    return;
+
+  std::unique_ptr<SendState> state(new SendState());
+  size_t count = std::min(queue.size(), static_cast<size_t>(IOV_MAX));
+  state->lines.reserve(count);
+  state->iov.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const OutputChunk &chunk = queue[i];
+    state->lines.push_back(chunk.line);
+    state->iov[i].iov_base =
+        const_cast<char *>(chunk.line->data() + chunk.offset);
+    state->iov[i].iov_len = chunk.line->size() - chunk.offset;
+  }
+  std::memset(&state->msg, 0, sizeof(state->msg));
+  state->msg.msg_iov = &state->iov[0];
+  state->msg.msg_iovlen = count;
+
+  io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(&state->msg);
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = tag(OP_SEND, s.gen, fd);
+  s.send = std::move(state);
+}
+
+/* ============================= */
+/*              WAIT             */
+/* ============================= */
+
+/**
+ * @brief Submits all queued SQEs and reaps completions in one syscall.
+ *
+ * Steps:
+ *  - Give the buffers handed out by the previous call back to the kernel
+ *  - io_uring_enter(to_submit = everything queued, min_complete = 1)
+ *  - Translate each CQE into an IoEvent, re-arming multishot requests the
+ *    kernel terminated
+ */
+int IoUringEventLoop::wait(std::vector<IoEvent> &events, int timeoutMs) {
+  events.clear();
+
+  for (size_t i = 0; i < _recycle.size(); ++i)
+    provideBuffer(_recycle[i]);
+  _recycle.clear();
+  publishBuffers();
+
+  unsigned head = *_cqHead;
+  bool ready = head != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+  unsigned minComplete = (ready || timeoutMs == 0) ? 0 : 1;
+
+  io_uring_getevents_arg arg;
+  __kernel_timespec ts;
+  std::memset(&arg, 0, sizeof(arg));
+  arg.sigmask_sz = _NSIG / 8;
+  if (timeoutMs > 0) {
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+  }
+
+  int n = uringEnter(_ringFd, _pending, minComplete,
+                     IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                     sizeof(arg));
+  if (n > 0)
+    _pending -= static_cast<unsigned>(n) < _pending ? n : _pending;
+  else if (n < 0 && errno != EINTR && errno != ETIME && errno != EBUSY &&
+           errno != EAGAIN)
+    throw std::runtime_error("io_uring_enter() failed");
+
+  unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const io_uring_cqe &cqe = _cqes[head & _cqMask];
+    int kind = static_cast<int>(cqe.user_data >> 56);
+    uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32) & 0xffffff;
+    int fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+    bool live = kind != OP_CANCEL && static_cast<size_t>(fd) < _slots.size() &&
+                _slots[fd].kind != NONE && (_slots[fd].gen & 0xffffff) == gen;
+
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+      uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      _recycle.push_back(bid);
+      if (live && cqe.res > 0) {
+        IoEvent ev(fd);
+        ev.readable = true;
+        ev.data = _bufBase + bid * BUFFER_SIZE;
+        ev.length = static_cast<size_t>(cqe.res);
+        events.push_back(ev);
+      }
+    }
+
+    if (kind == OP_SEND && !live) {
+      _orphans.erase(cqe.user_data);
+      continue;
+    }
+    if (!live) {
+      if (kind == OP_ACCEPT && cqe.res >= 0)
+        close(cqe.res); // accepted after its listener went away
+      continue;
+    }
+
+    switch (kind) {
+    case OP_ACCEPT: {
+      if (cqe.res >= 0) {
+        IoEvent ev(fd);
+        ev.readable = true;
+        ev.accepted = cqe.res;
+        events.push_back(ev);
+      }
+      if (!more)
+        armAccept(fd);
+      break;
+    }
+    case OP_RECV: {
+      if (cqe.res == -ENOBUFS || (cqe.res > 0 && !more)) {
+        armRecv(fd); // out of buffers or kernel stopped the multishot
+      } else if (cqe.res <= 0) {
+        IoEvent ev(fd); // EOF or socket error
+        ev.error = true;
+        events.push_back(ev);
+      }
+      break;
+    }
+    case OP_POLL: {
+      IoEvent ev(fd);
+      ev.readable = true;
+      events.push_back(ev);
+      if (!more)
+        armPoll(fd);
+      break;
+    }
+    case OP_SEND: {
+      _slots[fd].send.reset();
+      IoEvent ev(fd);
+      if (cqe.res >= 0) {
+        ev.writable = true;
+        ev.sent = cqe.res;
+      } else {
+        ev.error = true;
+      }
+      events.push_back(ev);
+      break;
+    }
+    }
+  }
+  __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+
+  return static_cast<int>(events.size());
+}
+
+bool IoUringEventLoop::isEdgeTriggered() const { return true; }
+
+bool IoUringEventLoop::completesIo() const { return true; }
+
+const char *IoUringEventLoop::name() const { return "io_uring"; }
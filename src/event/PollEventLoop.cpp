@@ -0,0 +1,96 @@
+/**
+ * @file PollEventLoop.cpp
+ * @brief poll() fallback backend for the server event loop.
+ */
+
+#include "../../includes/PollEventLoop.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+
+PollEventLoop::PollEventLoop() {}
+
+PollEventLoop::~PollEventLoop() {}
+
+/**
+ * @brief Adds a file descriptor to poll monitoring (read interest only).
+ */
+void PollEventLoop::add(int fd) {
+  if (fd < 0)
+    return;
+  if (static_cast<size_t>(fd) >= _index.size())
+    _index.resize(fd + 1, -1);
+  if (_index[fd] >= 0)
+    return;
+
+  pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  _index[fd] = static_cast<int>(_pollfds.size());
+  _pollfds.push_back(pfd);
+}
+
+/**
+ * @brief Removes a file descriptor from poll monitoring.
+ *
+ * The last pollfd is moved into the freed position, so removal does not
+ * shift the rest of the vector.
+ */
+void PollEventLoop::remove(int fd) {
+  pollfd *pfd = find(fd);
+  if (!pfd)
+    return;
+
+  int pos = _index[fd];
+  pollfd &last = _pollfds.back();
+  _index[last.fd] = pos;
+  *pfd = last;
+  _pollfds.pop_back();
+  _index[fd] = -1;
+}
+
+pollfd *PollEventLoop::find(int fd) {
+  if (fd < 0 || static_cast<size_t>(fd) >= _index.size() || _index[fd] < 0)
+    return NULL;
+  return &_pollfds[_index[fd]];
+}
+
+/**
+ * @brief Toggles POLLOUT for a client with (or without) queued output.
+ */
+void PollEventLoop::setWritable(int fd, bool enable) {
+  pollfd *pfd = find(fd);
+  if (!pfd)
+    return;
+  pfd->events = enable ? (POLLIN | POLLOUT) : POLLIN;
+}
+
+/**
+ * @brief Waits for activity and collects every pollfd with revents set.
+ */
+int PollEventLoop::wait(std::vector<IoEvent> &events, int timeoutMs) {
+  events.clear();
+  int n = poll(_pollfds.data(), _pollfds.size(), timeoutMs);
+  if (n < 0) {
+    if (errno == EINTR)
+      return 0;
+    throw std::runtime_error("poll() failed");
+  }
+
+  for (size_t i = 0; i < _pollfds.size() && (int)events.size() < n; ++i) {
+    short re = _pollfds[i].revents;
+    if (!re)
+      continue;
+    IoEvent ev(_pollfds[i].fd);
+    ev.readable = (re & POLLIN) != 0;
+    ev.writable = (re & POLLOUT) != 0;
+    ev.error = (re & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+    events.push_back(ev);
+  }
+  return static_cast<int>(events.size());
+}
+
+bool PollEventLoop::isEdgeTriggered() const { return false; }
+
+const char *PollEventLoop::name() const { return "poll"; }
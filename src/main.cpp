@@ -14,24 +14,55 @@
 #include <csignal>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 
 /**
  * @brief Entry point for IRC server.
  *
  * Steps:
- *  - Validate argument count
+ *  - Apply optional "--name=value" flags (e.g. --threads=4)
+ *  - Validate remaining argument count
  *  - Extract port and password
  *  - Create Server object
  *  - Run the server loop
  */
 int main(int argc, char **argv) {
-  if (argc != 3) {
-    std::cerr << "Usage: " << argv[0] << " <port> <password>" << std::endl;
+  ServerConfig config;
+  std::vector<std::string> args;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      args.push_back(arg);
+      continue;
+    }
+    if (!config.applyFlag(arg)) {
+      std::cerr << "Invalid option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  if (args.size() != 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--event-backend=uring|epoll|poll] [--threads=N]"
+                 " [--reserve-clients=N] [--reserve-channels=N]"
+                 " [--metrics-port=N]"
+                 " [--flood-rate=N] [--flood-burst=N] [--flood-queue=BYTES]"
+                 " [--ping-interval=S] [--ping-timeout=S]"
+                 " [--registration-timeout=S]"
+                 " [--backlog=N] [--defer-accept=S] [--tcp-nodelay=0|1]"
+                 " [--sndbuf=BYTES] [--rcvbuf=BYTES] [--accept-budget=N]"
+                 " [--read-budget=BYTES]"
+                 " [--sendq=BYTES] [--sendq-unregistered=BYTES]"
+                 " [--sendq-total=BYTES]"
+                 " [--log-connections=0|1] [--oper-password=SECRET]"
+                 " <port> <password>"
+              << std::endl;
     return 1;
   }
 
-  std::string port = argv[1];
-  std::string password = argv[2];
+  std::string port = args[0];
+  std::string password = args[1];
 
   try {
     // 1. Handle Shutdown Signals
@@ -44,7 +75,7 @@ int main(int argc, char **argv) {
     // NOT the server to crash.
     signal(SIGPIPE, SIG_IGN);
 
-    Server server(port, password);
+    Server server(port, password, config);
     server.run();
   } catch (const std::exception &e) {
     std::cerr << "Server error: " << e.what() << std::endl;
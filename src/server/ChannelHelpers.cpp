@@ -12,8 +12,11 @@
 
 #include "../../includes/Channel.hpp"
 #include "../../includes/Client.hpp"
+#include "../../includes/Casemap.hpp"
 #include "../../includes/Server.hpp"
 
+#include <algorithm>
+
 /* ============================= */
 /*        CHANNEL HELPERS        */
 /* ============================= */
@@ -30,8 +33,9 @@ Channel *Server::getOrCreateChannel(const std::string &name) {
   if (_channels.count(name))
     return _channels[name];
 
-  Channel *ch = new Channel(name);
+  Channel *ch = _channelPool.create(name);
   _channels[name] = ch;
+  _channelIndex.insert(name, ch);
   return ch;
 }
 
@@ -40,7 +44,8 @@ Channel *Server::getOrCreateChannel(const std::string &name) {
  *
  * Steps:
  *  - Check if the channel exists
- *  - If it has zero members, delete it and remove it from the map
+ *  - If it has zero members, remove it from both indexes
+ *  - Free it through rcu(): a lock-free PRIVMSG may still hold it
  */
 void Server::cleanupChannel(std::string name) {
   if (!_channels.count(name))
@@ -52,8 +57,9 @@ void Server::cleanupChannel(std::string name) {
 
   if (ch->getClients().empty()) {
     ch->clearInvites();
-    delete ch;
     _channels.erase(name);
+    _channelIndex.erase(name);
+    rcu().retire([this, ch] { _channelPool.destroy(ch); });
   }
 }
 
@@ -61,26 +67,61 @@ void Server::cleanupChannel(std::string name) {
  * @brief Finds a client by their nickname.
  *
  * Steps:
- *  - Iterate through all connected clients
- *  - Compare nickname with the given nick
+ *  - Casefold the nick (rfc1459)
+ *  - Look it up in the nickname index maintained by setClientNick()
+ *
+ * Needs _stateLock; lock-free readers use findRoute().
  *
- * @param nick Nickname to search for.
+ * @param nick Nickname to search for, in any case.
  * @return Client* Pointer if found, NULL otherwise.
  */
-Client *Server::getClientByNick(const std::string &nick) const {
-  for (std::map<int, Client *>::const_iterator it = _clients.begin();
-       it != _clients.end(); ++it) {
-    if (it->second->getNickname() == nick)
-      return it->second;
-  }
-  return NULL;
+Client *Server::getClientByNick(std::string_view nick) const {
+  const Route *route = findRoute(nick);
+  return route ? route->client : NULL;
+}
+
+/**
+ * @brief Same lookup, without the state lock: the Route stays valid until
+ * the caller's next quiescent state (see Rcu).
+ */
+const Route *Server::findRoute(std::string_view nick) const {
+  return _nicks.find(ircCasefold(nick));
+}
+
+/**
+ * @brief Records an invitation in the channel and in the per-client index.
+ *
+ * Invitations follow the client, not the nickname: a nick change keeps
+ * them, and the next holder of the old nick does not inherit them. The
+ * index is keyed on the connection id, since pooled Client addresses are
+ * handed to later connections.
+ */
+void Server::addInvite(Channel *channel, Client *client) {
+  channel->inviteClient(client);
+
+  std::vector<std::string> &names = _invites[client->getId()];
+  if (std::find(names.begin(), names.end(), channel->getName()) == names.end())
+    names.push_back(channel->getName());
 }
 
-void Server::removeInvitesForNick(const std::string &nick) {
-  for (std::map<std::string, Channel *>::iterator it = _channels.begin();
-       it != _channels.end(); ++it) {
-    Channel *channel = it->second;
-    if (channel)
-      channel->removeInvited(nick);
+/**
+ * @brief Drops every pending invitation of a client.
+ *
+ * Only the channels recorded by addInvite() are visited. Entries may be
+ * stale (invite already used, channel gone); they are looked up by name,
+ * so that is harmless.
+ */
+void Server::removeInvitesFor(Client *client) {
+  std::unordered_map<unsigned long, std::vector<std::string> >::iterator
+      entry = _invites.find(client->getId());
+  if (entry == _invites.end())
+    return;
+
+  const std::vector<std::string> &names = entry->second;
+  for (size_t i = 0; i < names.size(); ++i) {
+    std::map<std::string, Channel *>::iterator it = _channels.find(names[i]);
+    if (it != _channels.end())
+      it->second->removeInvited(client);
   }
+  _invites.erase(entry);
 }
@@ -14,79 +14,52 @@
 /*        CLIENT HANDLING        */
 /* ============================= */
 
+#include "../../includes/Casemap.hpp"
 #include "../../includes/Channel.hpp"
 #include "../../includes/Client.hpp"
 #include "../../includes/CommandHandler.hpp"
 #include "../../includes/Parser.hpp"
+#include "../../includes/Reactor.hpp"
 #include "../../includes/Server.hpp"
 
 #include <vector>
 
 /**
- * @brief Accepts a new client connection.
+ * @brief Adds a freshly accepted client to the shared directory.
+ *
+ * Called by the accepting reactor. The id lets reactors tell a client
+ * apart from a later connection that reuses the same fd.
  */
-void Server::acceptNewClient() {
-  sockaddr_in clientAddr;
-  socklen_t len = sizeof(clientAddr);
-
-  int clientFd = accept(_listenFd, (sockaddr *)&clientAddr, &len);
-  if (clientFd < 0)
-    return;
-
-  fcntl(clientFd, F_SETFL, O_NONBLOCK);
-
-  _clients[clientFd] = new Client(clientFd);
-
-  addPollFd(clientFd);
-
-  std::cout << "Client connected: fd " << clientFd << std::endl;
-}
-
-/**
- * @brief Reads data from a client and dispatches commands.
- */
-bool Server::handleClientRead(int index) {
-  int fd = _pollfds[index].fd;
-  char buffer[1024];
-
-  int bytes = recv(fd, buffer, sizeof(buffer), 0);
-  if (bytes <= 0) {
-    removeClient(fd);
-    return (false);
-  }
-
-  Client *c = _clients[fd];
-  c->appendToBuffer(std::string(buffer, bytes));
-
-  std::vector<std::string> msgs = extractMessages(c);
-  for (size_t i = 0; i < msgs.size(); i++) {
-    handleCommand(c, msgs[i]);
-  }
-
-  return (true);
+void Server::registerClient(Client *client) {
+  std::unique_lock<std::shared_mutex> lock(_stateLock);
+  client->setId(++_nextClientId);
+  _clients.set(client->getFd(), client);
 }
 
 /**
  * @brief Removes a client from the server.
+ *
+ * Must be called with _stateLock held exclusively, on the thread of the
+ * reactor that owns the client (its read path or its own QUIT).
  */
 void Server::removeClient(int fd) {
-  // Remove from all channels first
-  disconnectClientFromChannels(fd);
-
-  // Remove from poll
-  removePollFd(fd);
-
-  if (_clients.count(fd)) {
-    std::string nick = _clients[fd]->getNickname();
+  Client *client = _clients.get(fd);
+  if (client) {
+    std::string nick = client->getNickname();
+    // Every channel record of the client goes before its pooled address
+    // can be handed to the next connection
     disconnectClientFromChannels(fd);
+    removeInvitesFor(client);
     if (!nick.empty())
-      removeInvitesForNick(nick);
-    delete _clients[fd];
+      _nicks.erase(ircCasefold(nick));
     _clients.erase(fd);
+
+    // Remove from poll, close and free on the owning reactor
+    client->getOwner()->releaseClient(fd);
   }
-  close(fd);
 
-  std::cout << "Client disconnected: fd " << fd << std::endl;
+  if (_config.logConnections)
+    std::cout << "Client disconnected: fd " << fd << std::endl;
 }
 
 /**
@@ -97,38 +70,24 @@ void Server::removeClient(int fd) {
  * operator. When he exits, channel doesn't have an operator.
  * So even if another person joins in, he will not be the operator.
  * Also it is a wise method to save memory.
+ *
+ * Driven by the client's own joined list, so the cost is O(channels the
+ * client is in), not O(all channels).
  */
 void Server::disconnectClientFromChannels(int fd) {
-  if (!_clients.count(fd))
+  Client *client = _clients.get(fd);
+  if (!client)
     return;
 
-  Client *client = _clients[fd];
-
-  // Iterate thru channels
-  std::map<std::string, Channel *>::iterator it = _channels.begin();
-  while (it != _channels.end()) {
-    Channel *channel = it->second;
-
-    if (channel->hasClient(client)) {
-      // Client found in the channel
-      // Remove the client from the channel
-      channel->removeClient(client);
+  // Copy: leaveChannel() below shrinks the client's list. Walking it
+  // backwards keeps every erase at the end of that list.
+  std::vector<Channel *> joined = client->getJoinedChannels();
+  for (size_t i = joined.size(); i-- > 0;) {
+    Channel *channel = joined[i];
+    channel->removeClient(client);
+    client->leaveChannel(channel);
 
-      // If channel is empty, delete it
-      if (channel->getClients().empty()) {
-        delete channel;
-        // get the next valid iterator first and then erase prev
-        std::map<std::string, Channel *>::iterator to_erase = it;
-        ++it;
-        _channels.erase(to_erase);
-      } else {
-        // Just move to next channel
-        ++it;
-      }
-    } else {
-      // Client wasn't found in the channel
-      // move to next one
-      ++it;
-    }
+    // If channel is empty, delete it
+    cleanupChannel(channel->getName());
   }
 }
@@ -0,0 +1,244 @@
+/**
+ * @file MetricsEndpoint.cpp
+ * @brief Prometheus scrape endpoint served from reactor 0's event loop.
+ */
+
+#include "../../includes/MetricsEndpoint.hpp"
+#include "../../includes/Server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MetricsEndpoint::MetricsEndpoint(Server *server, EventLoop *loop)
+    : _server(server), _loop(loop), _listenFd(-1) {}
+
+MetricsEndpoint::~MetricsEndpoint() {
+  while (!_connections.empty())
+    closeConnection(_connections.begin()->first);
+  if (_listenFd != -1) {
+    _loop->remove(_listenFd);
+    close(_listenFd);
+  }
+}
+
+/**
+ * @brief Binds the listener to 127.0.0.1 only: the endpoint has no
+ * authentication, so it must not be reachable from other hosts.
+ */
+void MetricsEndpoint::open(int port) {
+  _listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (_listenFd < 0)
+    throw std::runtime_error("socket() failed for the metrics endpoint");
+
+  int yes = 1;
+  setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  if (bind(_listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    throw std::runtime_error("bind() failed for the metrics endpoint");
+  if (listen(_listenFd, 16) < 0)
+    throw std::runtime_error("listen() failed for the metrics endpoint");
+  _loop->add(_listenFd);
+}
+
+bool MetricsEndpoint::owns(int fd) const {
+  return fd == _listenFd ||
+         (!_connections.empty() && _connections.count(fd));
+}
+
+/**
+ * @brief Routes one event of the listener or of a scrape connection.
+ */
+void MetricsEndpoint::handle(const IoEvent &ev) {
+  if (ev.fd == _listenFd) {
+    if (ev.accepted >= 0)
+      adopt(ev.accepted); // accepted by the backend itself
+    else if (ev.readable)
+      acceptAll();
+    return;
+  }
+  if (ev.data)
+    receive(ev.fd, ev.data, ev.length);
+  else if (ev.error && _loop->completesIo())
+    closeConnection(ev.fd);
+  else if (ev.readable || ev.error)
+    readAll(ev.fd);
+
+  if (ev.writable && _connections.count(ev.fd)) {
+    if (_loop->completesIo())
+      consume(ev.fd, ev.sent); // completion of submitSend()
+    else
+      flush(ev.fd);
+  }
+}
+
+/* ============================= */
+/*          CONNECTIONS          */
+/* ============================= */
+
+void MetricsEndpoint::acceptAll() {
+  while (true) {
+    int fd = accept4(_listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+      return;
+    adopt(fd);
+  }
+}
+
+void MetricsEndpoint::adopt(int fd) {
+  _connections[fd].answered = false;
+  _loop->add(fd);
+}
+
+/* Reads until EAGAIN, which also suits edge-triggered backends */
+void MetricsEndpoint::readAll(int fd) {
+  char buf[1024];
+  while (true) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return;
+    if (n <= 0) {
+      closeConnection(fd);
+      return;
+    }
+    receive(fd, buf, n);
+    std::map<int, Connection>::iterator it = _connections.find(fd);
+    if (it == _connections.end() || it->second.answered)
+      return; // answered; the rest of the request is not needed
+  }
+}
+
+/**
+ * @brief Buffers request bytes and answers once the headers are complete.
+ * Anything received after that is ignored.
+ */
+void MetricsEndpoint::receive(int fd, const char *data, size_t length) {
+  std::map<int, Connection>::iterator it = _connections.find(fd);
+  if (it == _connections.end() || it->second.answered)
+    return;
+  std::string &request = it->second.request;
+  request.append(data, length);
+  if (request.find("\r\n\r\n") == std::string::npos &&
+      request.find("\n\n") == std::string::npos &&
+      request.size() < MAX_REQUEST)
+    return;
+
+  respond(it->second);
+  flush(fd);
+}
+
+/**
+ * @brief Renders the HTTP response: the metrics for GET /metrics, 404 for
+ * any other path, 405 for any other method. It is queued on the
+ * connection; flush() sends it.
+ */
+void MetricsEndpoint::respond(Connection &conn) {
+  const std::string &request = conn.request;
+  std::string status = "200 OK";
+  std::string body;
+  if (request.compare(0, 4, "GET ") != 0) {
+    status = "405 Method Not Allowed";
+    body = "only GET is supported\n";
+  } else if (request.compare(4, 9, "/metrics ") != 0 &&
+             request.compare(4, 9, "/metrics?") != 0) {
+    status = "404 Not Found";
+    body = "try /metrics\n";
+  } else {
+    _server->renderMetrics(body);
+  }
+
+  OutputChunk chunk;
+  chunk.line = std::make_shared<const std::string>(
+      "HTTP/1.1 " + status +
+      "\r\nContent-Type: text/plain; version=0.0.4"
+      "\r\nContent-Length: " +
+      std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+  chunk.offset = 0;
+  conn.response.push_back(chunk);
+  conn.answered = true;
+  std::string().swap(conn.request);
+}
+
+/**
+ * @brief Writes as much of the response as the socket takes.
+ *
+ * Write interest is armed while the socket is full and the connection is
+ * closed once everything is sent, or on an error. A completion backend
+ * gets the response as one submitted send instead; consume() sees its
+ * result.
+ */
+void MetricsEndpoint::flush(int fd) {
+  std::map<int, Connection>::iterator it = _connections.find(fd);
+  if (it == _connections.end() || !it->second.answered)
+    return;
+  OutputQueue &out = it->second.response;
+
+  if (_loop->completesIo()) {
+    if (out.empty())
+      closeConnection(fd);
+    else if (!_loop->sendInFlight(fd))
+      _loop->submitSend(fd, out);
+    return;
+  }
+
+  while (!out.empty()) {
+    const OutputChunk &chunk = out.front();
+    ssize_t n = send(fd, chunk.line->data() + chunk.offset,
+                     chunk.line->size() - chunk.offset, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      _loop->setWritable(fd, true); // resume on the next write event
+      return;
+    }
+    if (n <= 0)
+      break;
+    out.front().offset += n;
+    if (out.front().offset == out.front().line->size())
+      out.pop_front();
+  }
+  closeConnection(fd);
+}
+
+/**
+ * @brief Accounts for a completed send of a completion backend, then
+ * sends the rest or closes the connection.
+ */
+void MetricsEndpoint::consume(int fd, long sent) {
+  std::map<int, Connection>::iterator it = _connections.find(fd);
+  if (it == _connections.end())
+    return;
+  OutputQueue &out = it->second.response;
+  if (sent < 0) {
+    closeConnection(fd);
+    return;
+  }
+  size_t left = static_cast<size_t>(sent);
+  while (left > 0 && !out.empty()) {
+    OutputChunk &chunk = out.front();
+    size_t n = std::min(left, chunk.line->size() - chunk.offset);
+    chunk.offset += n;
+    left -= n;
+    if (chunk.offset == chunk.line->size())
+      out.pop_front();
+  }
+  flush(fd);
+}
+
+void MetricsEndpoint::closeConnection(int fd) {
+  if (!_connections.erase(fd))
+    return;
+  _loop->remove(fd);
+  close(fd);
+}
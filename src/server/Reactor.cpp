@@ -0,0 +1,983 @@
+/**
+ * @file Reactor.cpp
+ * @brief Per-thread event loop: listener, socket I/O and cross-thread
+ *        output delivery for the clients owned by one shard.
+ */
+
+#include "../../includes/Reactor.hpp"
+#include "../../includes/Client.hpp"
+#include "../../includes/EventLoop.hpp"
+#include "../../includes/Metrics.hpp"
+#include "../../includes/MetricsEndpoint.hpp"
+#include "../../includes/Replies.hpp"
+#include "../../includes/Server.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <netinet/tcp.h>
+#include <shared_mutex>
+#include <stdint.h>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+
+thread_local Reactor *Reactor::_current = NULL;
+
+static const uint64_t NS_PER_SEC = 1000000000ull;
+
+/* ============================= */
+/*          CONSTRUCTION         */
+/* ============================= */
+
+Reactor::Reactor(Server *server, int id)
+    : _server(server), _id(id), _loop(NULL), _listenFd(-1), _wakeFd(-1),
+      _metricsEndpoint(NULL), _acceptPending(false),
+      _readScratch(READ_SCRATCH), _queuedBytes(0),
+      _sendqShare(server->_config.sendQueueTotal / server->_config.threads),
+      _queuedBytesSeen(0), _now(0),
+      _floodStep(server->_config.floodRate
+                     ? NS_PER_SEC / server->_config.floodRate
+                     : 0),
+      _floodBurst(_floodStep * server->_config.floodBurst),
+      _timers(NS_PER_SEC, monotonicNs()) {}
+
+Reactor::~Reactor() {
+  if (_thread.joinable())
+    _thread.join();
+  if (_listenFd != -1)
+    close(_listenFd);
+  if (_wakeFd != -1)
+    close(_wakeFd);
+  delete _metricsEndpoint; // before the loop it is registered with
+  delete _loop;
+}
+
+int Reactor::getId() const { return _id; }
+
+/**
+ * @brief True when called from the thread that runs this reactor.
+ */
+bool Reactor::isCurrent() const { return _current == this; }
+
+/**
+ * @brief Pre-allocates Client slots; called before the reactor starts.
+ */
+void Reactor::reserveClients(size_t count) { _clientPool.reserve(count); }
+
+/**
+ * @brief Appends one line per pool: objects in use, slots allocated, peak.
+ * Only reads the pools' atomic counters, so any thread may call it.
+ */
+void Reactor::reportPools(std::vector<std::string> &lines) const {
+  std::string shard = "reactor " + std::to_string(_id);
+  lines.push_back("clients " + shard + ": " +
+                  std::to_string(_clientPool.inUse()) + " used, " +
+                  std::to_string(_clientPool.capacity()) + " allocated, " +
+                  std::to_string(_clientPool.peak()) + " peak");
+  lines.push_back("input-buffers " + shard + ": " +
+                  std::to_string(_bufferPool.inUse()) + " used, " +
+                  std::to_string(_bufferPool.capacity()) + " allocated, " +
+                  std::to_string(_bufferPool.peak()) + " peak");
+}
+
+/* ============================= */
+/*         SOCKET SETUP          */
+/* ============================= */
+
+/**
+ * @brief Creates the event backend, wake fd and listening socket.
+ *
+ * Steps:
+ *  - Create the configured event backend (io_uring, epoll or poll)
+ *  - Create the eventfd other threads use to wake us up
+ *  - Create a non-blocking IPv4 TCP socket
+ *  - Enable SO_REUSEADDR and SO_REUSEPORT (one listener per reactor)
+ *  - Apply the listener options (see applyListenerOptions)
+ *  - Bind to the configured port
+ *  - Listen for connections, with the configured backlog
+ *  - Add both fds to the poll list
+ *  - Reactor 0 also opens the localhost metrics endpoint, if configured
+ */
+void Reactor::initSocket() {
+  _loop = EventLoop::create(_server->_config.eventBackend);
+  if (_id == 0)
+    std::cout << "Event backend: " << _loop->name() << std::endl;
+
+  _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (_wakeFd < 0)
+    throw std::runtime_error("eventfd() failed");
+  addPollFd(_wakeFd);
+
+  // non-blocking I/O for the event loop
+  _listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (_listenFd < 0)
+    throw std::runtime_error("socket() failed");
+
+  int yes = 1; // Enable and Disable switch
+  setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  // every reactor binds the same port; the kernel balances accepts
+  if (setsockopt(_listenFd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) < 0)
+    throw std::runtime_error("setsockopt(SO_REUSEPORT) failed");
+  applyListenerOptions();
+
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = INADDR_ANY;
+  addr.sin_port = htons(std::atoi(_server->_port.c_str()));
+
+  if (bind(_listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    throw std::runtime_error("bind() failed");
+
+  // the kernel caps the backlog at net.core.somaxconn
+  if (listen(_listenFd, _server->_config.listenBacklog) < 0)
+    throw std::runtime_error("listen() failed");
+
+  addPollFd(_listenFd);
+
+  if (_id == 0 && _server->_config.metricsPort > 0) {
+    _metricsEndpoint = new MetricsEndpoint(_server, _loop);
+    _metricsEndpoint->open(_server->_config.metricsPort);
+    std::cout << "Metrics: http://127.0.0.1:" << _server->_config.metricsPort
+              << "/metrics" << std::endl;
+  }
+}
+
+/**
+ * @brief Sets the configured socket options on the listener.
+ *
+ * Linux copies TCP_NODELAY and the buffer sizes to every socket accepted
+ * from it, including the ones io_uring accepts, so accepted connections
+ * need no setsockopt() of their own. Buffer sizes must be set before
+ * listen() for the receive window to scale to them. TCP_DEFER_ACCEPT
+ * keeps a connection in the kernel until its first bytes arrive (IRC
+ * clients speak first), so silent connections never reach accept().
+ */
+void Reactor::applyListenerOptions() {
+  const ServerConfig &config = _server->_config;
+  int yes = 1;
+  if (config.tcpNoDelay &&
+      setsockopt(_listenFd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)) < 0)
+    throw std::runtime_error("setsockopt(TCP_NODELAY) failed");
+  if (config.deferAccept > 0 &&
+      setsockopt(_listenFd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &config.deferAccept,
+                 sizeof(config.deferAccept)) < 0)
+    throw std::runtime_error("setsockopt(TCP_DEFER_ACCEPT) failed");
+  if (config.sendBuffer > 0 &&
+      setsockopt(_listenFd, SOL_SOCKET, SO_SNDBUF, &config.sendBuffer,
+                 sizeof(config.sendBuffer)) < 0)
+    throw std::runtime_error("setsockopt(SO_SNDBUF) failed");
+  if (config.recvBuffer > 0 &&
+      setsockopt(_listenFd, SOL_SOCKET, SO_RCVBUF, &config.recvBuffer,
+                 sizeof(config.recvBuffer)) < 0)
+    throw std::runtime_error("setsockopt(SO_RCVBUF) failed");
+}
+
+/* ============================= */
+/*            THREADS            */
+/* ============================= */
+
+/**
+ * @brief Runs mainLoop() on a dedicated thread.
+ */
+void Reactor::start() { _thread = std::thread(&Reactor::mainLoop, this); }
+
+void Reactor::join() {
+  if (_thread.joinable())
+    _thread.join();
+}
+
+/**
+ * @brief Interrupts wait() from another thread (new inbox data, shutdown).
+ */
+void Reactor::wake() {
+  uint64_t one = 1;
+  ssize_t n = write(_wakeFd, &one, sizeof(one));
+  (void)n; // counter saturation just means a wakeup is already pending
+}
+
+/* ============================= */
+/*           MAIN LOOP           */
+/* ============================= */
+
+/**
+ * @brief Event loop for the fds owned by this reactor.
+ *
+ * The EventLoop only reports fds that are ready, so one iteration costs
+ * O(ready fds) with epoll. Output is flushed once per iteration: clients
+ * whose output queue became non-empty, and clients whose socket became
+ * writable again, are collected in _pendingSend while events are handled
+ * and written right before the next wait, so a client gets one sendmsg()
+ * however many lines were queued for it. Write interest is only armed for
+ * sockets that could not take everything.
+ *
+ * Throttled clients whose token bucket refilled run their deferred lines
+ * before the flush, and clients that went over a send queue limit are
+ * disconnected before it. wait() only blocks until the next throttled
+ * client or client timer is due; timers run first after each wakeup.
+ *
+ * The time from a wakeup to the next wait (processing plus the flush) is
+ * recorded as the loop iteration time.
+ *
+ * The reactor is an Rcu reader: going offline for wait() is its quiescent
+ * state, so anything retired before it blocks can be freed meanwhile.
+ */
+void Reactor::mainLoop() {
+  _current = this;
+  rcu().registerReader(_rcuReader);
+  uint64_t wokeAt = 0;
+
+  while (Server::_signal == false) {
+    // === PHASE 1: FLUSH OUTPUT ===
+    // Deferred input first, so its replies go out with this flush.
+    // Only clients that queued output or became writable since the last
+    // iteration
+    if (!_throttled.empty())
+      resumeThrottled();
+    while (!_sendqExceeded.empty())
+      dropSendqExceeded();
+    flushPendingWrites();
+    _queuedBytesSeen.store(_queuedBytes, std::memory_order_relaxed);
+    if (wokeAt)
+      metrics().loopIterationTime.observe(monotonicNs() - wokeAt);
+
+    // === PHASE 2: WAIT ===
+    rcu().offline(_rcuReader);
+    _loop->wait(_events, nextTimeout());
+    rcu().online(_rcuReader);
+    if (Server::_signal)
+      break;
+    wokeAt = _now = monotonicNs();
+
+    // === PHASE 3: TIMERS ===
+    expireTimers();
+
+    // === PHASE 4: PROCESS ===
+    // Connections and input left over when the last budgets ran out
+    if (_acceptPending)
+      acceptNewClient();
+    if (!_readPending.empty())
+      resumeReads();
+
+    for (size_t i = 0; i < _events.size(); i++) {
+      const IoEvent &ev = _events[i];
+
+      // 1. Listener
+      if (ev.fd == _listenFd) {
+        if (ev.accepted >= 0)
+          adoptClient(ev.accepted); // accepted by the backend itself
+        else if (ev.readable)
+          acceptNewClient();
+        continue;
+      }
+
+      // 2. Output posted by other reactors
+      if (ev.fd == _wakeFd) {
+        drainInbox();
+        continue;
+      }
+
+      // 3. Metrics scrapes (reactor 0)
+      if (_metricsEndpoint && _metricsEndpoint->owns(ev.fd)) {
+        _metricsEndpoint->handle(ev);
+        continue;
+      }
+
+      // 4. Client Operations
+      // The only client lookup of this event
+      Client *client = _clients.get(ev.fd);
+      if (!client)
+        continue; // Already removed earlier in this iteration
+
+      // READ (Incoming)
+      if (ev.data) {
+        // completion backend: bytes were already received into ev.data
+        if (!handleClientData(client, ev.data, ev.length))
+          continue;
+      } else if (ev.error && _loop->completesIo()) {
+        dropClient(ev.fd);
+        continue;
+      } else if (ev.readable || ev.error) {
+        if (!handleClientRead(client, ev.error))
+          continue; // Don't try to write to a dead client
+      }
+
+      // WRITE (Outgoing): left to the flush, with the lines queued below
+      if (ev.writable) {
+        if (ev.sent > 0) {
+          client->consumeBytes(ev.sent); // completion of submitSend()
+          metrics().sendBytes.observe(ev.sent);
+          metrics().bytesSent.add(ev.sent);
+        }
+        if (client->hasPendingSend())
+          markPendingSend(ev.fd);
+      }
+    }
+  }
+  rcu().unregisterReader(_rcuReader);
+}
+
+/* ============================= */
+/*       POLL FD MANAGEMENT      */
+/* ============================= */
+
+/**
+ * @brief Adds a file descriptor to event loop monitoring.
+ */
+void Reactor::addPollFd(int fd) { _loop->add(fd); }
+
+/**
+ * @brief Removes a file descriptor from event loop monitoring.
+ */
+void Reactor::removePollFd(int fd) { _loop->remove(fd); }
+
+/**
+ * @brief Remembers a client whose output queue just became non-empty, or
+ * whose socket can take the rest of its queue again. Only called on this
+ * reactor's own thread (see Client::queueMessage).
+ */
+void Reactor::markPendingSend(int fd) { _pendingSend.push_back(fd); }
+
+/**
+ * @brief Counts a line about to be queued for one of our clients against
+ * this reactor's share of --sendq-total. Called by Client::queueMessage
+ * on this reactor's thread, once the client's own limit is checked.
+ *
+ * Over the share, the line is refused only if the client already holds
+ * more than its fair part of it (share / clients): the clients that keep
+ * up are not punished for the ones that do not.
+ */
+bool Reactor::admitOutput(const Client *c, size_t bytes) {
+  if (_sendqShare && _queuedBytes + bytes > _sendqShare &&
+      c->getOutputBufferSize() + bytes > _sendqShare / _clients.size())
+    return false;
+  _queuedBytes += bytes;
+  return true;
+}
+
+/**
+ * @brief Takes sent or discarded output off the reactor's total.
+ */
+void Reactor::releaseOutput(size_t bytes) { _queuedBytes -= bytes; }
+
+/**
+ * @brief Marks a client whose send queue went over a limit. It may be in
+ * the middle of a handler, under the state lock, so it is only parked
+ * on _sendqExceeded; dropSendqExceeded() disconnects it before the next
+ * flush.
+ */
+void Reactor::exceedSendq(Client *c) {
+  c->setSendqExceeded(true);
+  _sendqExceeded.push_back(c->getFd());
+  metrics().sendqDisconnects.add();
+}
+
+/**
+ * @brief Output bytes queued for this reactor's clients as of its last
+ * flush; any thread may read it (metrics, STATS q).
+ */
+size_t Reactor::getQueuedBytes() const {
+  return _queuedBytesSeen.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Flushes every client that queued output since the last wait.
+ *
+ * Steps:
+ *  - Walk the fds collected by markPendingSend()
+ *  - Skip clients that disconnected or already drained their queue
+ *  - Write the rest right away; handleClientWrite() only arms write
+ *    interest when the socket buffer fills up. On a completion backend
+ *    this queues the send, so it is submitted by the same io_uring_enter
+ *    that waits for the next events
+ */
+void Reactor::flushPendingWrites() {
+  for (size_t i = 0; i < _pendingSend.size(); ++i) {
+    Client *client = _clients.get(_pendingSend[i]);
+    if (!client || !client->hasPendingSend())
+      continue;
+    handleClientWrite(client);
+  }
+  _pendingSend.clear();
+}
+
+/**
+ * @brief wait() timeout in ms: 0 while the accept queue or a client still
+ * holds input past its budget, else until the next client timer or the
+ * first throttled client may run again, -1 (block) when none is pending.
+ */
+int Reactor::nextTimeout() const {
+  if (_acceptPending || !_readPending.empty())
+    return 0;
+  uint64_t now = monotonicNs();
+  int timeout = _timers.timeoutMs(now);
+  if (_throttled.empty())
+    return timeout;
+
+  uint64_t due = UINT64_MAX;
+  for (size_t i = 0; i < _throttled.size(); ++i) {
+    const Client *client = _clients.get(_throttled[i]);
+    if (!client)
+      return 0; // let resumeThrottled() drop the stale entry
+    uint64_t at = client->getFloodClock() - _floodBurst;
+    if (at < due)
+      due = at;
+  }
+  int flood = due <= now ? 0 : static_cast<int>((due - now + 999999) / 1000000);
+  return timeout < 0 || flood < timeout ? flood : timeout;
+}
+
+/* ============================= */
+/*         FLOOD CONTROL         */
+/* ============================= */
+
+/**
+ * @brief True if the client may run another line now.
+ *
+ * The token bucket is kept as a single timestamp (the virtual clock of
+ * GCRA): running a line moves the client's flood clock forward by
+ * cost * _floodStep, and the bucket is full again once the clock falls
+ * behind the current time. A client has credit while its clock is less
+ * than _floodBurst (the bucket size) ahead of now, so it may spend a
+ * burst at once and then one token per _floodStep.
+ */
+bool Reactor::hasFloodCredit(const Client *c) const {
+  return c->getFloodClock() < _now + _floodBurst;
+}
+
+/**
+ * @brief Spends cost tokens of the client's bucket. A full bucket does not
+ * hold more than _floodBurst, so idle time is not banked beyond that.
+ */
+void Reactor::chargeFlood(Client *c, unsigned cost) {
+  uint64_t clock = c->getFloodClock() > _now ? c->getFloodClock() : _now;
+  c->setFloodClock(clock + cost * _floodStep);
+}
+
+/**
+ * @brief Parks a client whose bucket is empty; its remaining lines stay
+ * in its input buffer until resumeThrottled() runs them.
+ */
+void Reactor::throttle(Client *c) {
+  if (c->isThrottled())
+    return;
+  c->setThrottled(true);
+  _throttled.push_back(c->getFd());
+  metrics().floodThrottled.add();
+}
+
+/**
+ * @brief Runs the deferred lines of every throttled client that has
+ * credit again; the others stay on the list.
+ *
+ * Deferred lines carry no read timestamp, so the time they spent held
+ * back is not counted as dispatch delay.
+ */
+void Reactor::resumeThrottled() {
+  _now = monotonicNs();
+  _resuming.swap(_throttled);
+  for (size_t i = 0; i < _resuming.size(); ++i) {
+    Client *client = _clients.get(_resuming[i]);
+    if (!client || !client->isThrottled())
+      continue; // disconnected (or its fd reused) since it was parked
+    if (!hasFloodCredit(client)) {
+      _throttled.push_back(_resuming[i]);
+      continue;
+    }
+    client->setThrottled(false);
+    processInput(client, 0);
+  }
+  _resuming.clear();
+}
+
+/* ============================= */
+/*             TIMERS            */
+/* ============================= */
+
+/**
+ * @brief Arms a new client's timer: its registration deadline, or the
+ * first keepalive check when registration has no deadline.
+ */
+void Reactor::startClientTimer(Client *c) {
+  const ServerConfig &config = _server->_config;
+  unsigned seconds = config.registrationTimeout ? config.registrationTimeout
+                                                : config.pingInterval;
+  c->getTimer().data = c;
+  if (seconds)
+    _timers.schedule(c->getTimer(), _now + seconds * NS_PER_SEC);
+}
+
+/**
+ * @brief Runs the client timers that came due since the last wakeup.
+ */
+void Reactor::expireTimers() {
+  _timers.advance(_now);
+  while (TimerWheel::Timer *timer = _timers.nextExpired())
+    clientTimerFired(static_cast<Client *>(timer->data));
+}
+
+/**
+ * @brief Handles one client's timer.
+ *
+ * Steps:
+ *  - Still unregistered: the registration deadline passed, disconnect
+ *  - Server PING outstanding and nothing read since: disconnect
+ *  - Nothing read for --ping-interval: send PING, wait --ping-timeout
+ *  - Otherwise re-arm for the end of the interval since the last read
+ *
+ * Reads only record a timestamp (noteActivity), so a busy client costs
+ * one timer run per interval instead of a reschedule per read.
+ */
+void Reactor::clientTimerFired(Client *c) {
+  const ServerConfig &config = _server->_config;
+  if (!c->isAuthenticated() && config.registrationTimeout) {
+    metrics().registrationTimeouts.add();
+    rejectClient(c, "Registration timed out");
+    return;
+  }
+  if (!config.pingInterval)
+    return;
+  if (c->isAwaitingPong()) {
+    metrics().pingTimeouts.add();
+    rejectClient(c, "Ping timeout: " + std::to_string(config.pingTimeout) +
+                        " seconds");
+    return;
+  }
+
+  uint64_t idleUntil = c->getLastActivity() + config.pingInterval * NS_PER_SEC;
+  if (idleUntil > _now) {
+    _timers.schedule(c->getTimer(), idleUntil);
+    return;
+  }
+  c->queueMessage(makeReply(MSG_PING));
+  c->setAwaitingPong(true);
+  metrics().pingsSent.add();
+  _timers.schedule(c->getTimer(), _now + config.pingTimeout * NS_PER_SEC);
+}
+
+/**
+ * @brief Records that the client sent something: any input, not only a
+ * PONG, proves the connection alive.
+ */
+void Reactor::noteActivity(Client *c) {
+  c->setLastActivity(_now);
+  c->setAwaitingPong(false);
+}
+
+/* ============================= */
+/*     CROSS-THREAD DELIVERY     */
+/* ============================= */
+
+/**
+ * @brief Queues output for one of our clients from another thread.
+ *
+ * Only the SharedLine reference crosses threads, never the bytes.
+ * Only the first message of a batch writes to the eventfd; the rest ride
+ * on the same wakeup.
+ */
+void Reactor::post(int fd, unsigned long clientId, const SharedLine &line) {
+  bool wasEmpty;
+  {
+    std::lock_guard<std::mutex> lock(_inboxMutex);
+    wasEmpty = _inbox.empty() && _batches.empty();
+    Delivery d;
+    d.fd = fd;
+    d.clientId = clientId;
+    d.line = line;
+    _inbox.push_back(d);
+  }
+  if (wasEmpty)
+    wake();
+}
+
+/**
+ * @brief Queues one broadcast line for several of our clients.
+ *
+ * Channel::broadcast groups the members by owner and calls this once per
+ * reactor, so a line costs one lock and at most one wakeup per shard
+ * however many of its members live here. The recipient list is taken
+ * over; to is left empty.
+ */
+void Reactor::postBatch(const SharedLine &line, std::vector<Recipient> &to) {
+  bool wasEmpty;
+  {
+    std::lock_guard<std::mutex> lock(_inboxMutex);
+    wasEmpty = _inbox.empty() && _batches.empty();
+    _batches.push_back(Batch());
+    _batches.back().line = line;
+    _batches.back().to.swap(to);
+  }
+  if (wasEmpty)
+    wake();
+}
+
+/**
+ * @brief Moves posted messages into the owning clients' output queues.
+ *
+ * Steps:
+ *  - Reset the eventfd counter
+ *  - Swap the inbox and the batches out under the lock
+ *  - Append each message to its client if it is still connected; lines
+ *    were counted where they were posted, so enqueue does not count them
+ */
+void Reactor::drainInbox() {
+  uint64_t counter;
+  while (read(_wakeFd, &counter, sizeof(counter)) > 0)
+    ;
+
+  {
+    std::lock_guard<std::mutex> lock(_inboxMutex);
+    _draining.swap(_inbox);
+    _drainingBatches.swap(_batches);
+  }
+
+  for (size_t i = 0; i < _draining.size(); ++i) {
+    const Delivery &d = _draining[i];
+    Client *client = _clients.get(d.fd);
+    if (client && client->getId() == d.clientId)
+      client->enqueue(d.line);
+  }
+  _draining.clear();
+
+  for (size_t i = 0; i < _drainingBatches.size(); ++i) {
+    const Batch &b = _drainingBatches[i];
+    for (size_t j = 0; j < b.to.size(); ++j) {
+      Client *client = _clients.get(b.to[j].fd);
+      if (client && client->getId() == b.to[j].clientId)
+        client->enqueue(b.line);
+    }
+  }
+  _drainingBatches.clear();
+}
+
+/* ============================= */
+/*        CLIENT HANDLING        */
+/* ============================= */
+
+/**
+ * @brief Accepts pending connections, up to --accept-budget per call.
+ *
+ * accept4() hands back sockets that are already non-blocking and
+ * close-on-exec, so a connection costs one syscall. The budget keeps a
+ * reconnect storm from starving the clients already connected: when it
+ * runs out the rest of the queue is taken on the next iteration, which
+ * then does not block in wait() (an edge-triggered backend would not
+ * report the listener again).
+ */
+void Reactor::acceptNewClient() {
+  _acceptPending = false;
+  for (int budget = _server->_config.acceptBudget; budget > 0; --budget) {
+    int clientFd =
+        accept4(_listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (clientFd < 0)
+      return; // queue drained (EAGAIN) or out of fds: retried on next event
+    adoptClient(clientFd);
+  }
+  _acceptPending = true;
+}
+
+/**
+ * @brief Creates the Client for an accepted socket and starts watching it.
+ */
+void Reactor::adoptClient(int clientFd) {
+  Client *client = _clientPool.create(clientFd);
+  client->setOwner(this);
+  client->setSendqLimit(_server->_config.sendQueueUnregistered);
+  client->getInput().setPool(&_bufferPool);
+  client->setLastActivity(_now);
+  startClientTimer(client);
+  _clients.set(clientFd, client);
+
+  addPollFd(clientFd);
+  _server->registerClient(client);
+  metrics().connectionsAccepted.add();
+  metrics().clients.add(1);
+
+  if (_server->_config.logConnections)
+    std::cout << "Client connected: fd " << clientFd << std::endl;
+}
+
+/**
+ * @brief Reads data from a client straight into its input buffer and
+ * dispatches every complete line.
+ *
+ * Steps:
+ *  - readv() fills the free tail of the input buffer first and spills
+ *    into the reactor's scratch buffer, so one call takes a whole burst;
+ *    the spill is fed in after the lines already in place have run
+ *  - A read that returns less than asked for drained the socket: stop
+ *    without the extra call that would only report EAGAIN. Not after a
+ *    hangup though, whose end of file must still be read
+ *  - At most --read-budget bytes per client and iteration, so one fast
+ *    sender cannot hold up the others. Level-triggered backends report a
+ *    client with input left again; edge-triggered ones will not, so it is
+ *    parked on _readPending and read again on the next iteration
+ *  - EINTR retries the read, EAGAIN means drained; only end of file or a
+ *    real error disconnects
+ *
+ * @param hangup The peer closed or reset the connection.
+ * @return false if the client was removed.
+ */
+bool Reactor::handleClientRead(Client *c, bool hangup) {
+  int fd = c->getFd();
+  InputBuffer &input = c->getInput();
+  size_t budget = _server->_config.readBudget;
+
+  while (true) {
+    iovec iov[2];
+    iov[0].iov_base = input.writePtr();
+    iov[0].iov_len = input.writeSpace() < budget ? input.writeSpace() : budget;
+    size_t spill = budget - iov[0].iov_len;
+    iov[1].iov_base = &_readScratch[0];
+    iov[1].iov_len = spill < READ_SCRATCH ? spill : READ_SCRATCH;
+
+    ssize_t bytes = readv(fd, iov, 2);
+    if (bytes < 0 && errno == EINTR)
+      continue; // interrupted by a signal before anything was read
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      metrics().recvBytes.observe(0);
+      return (true);
+    }
+    if (bytes <= 0) {
+      dropClient(fd);
+      return (false);
+    }
+    size_t received = static_cast<size_t>(bytes);
+    size_t inPlace = received < iov[0].iov_len ? received : iov[0].iov_len;
+    metrics().recvBytes.observe(received);
+    metrics().bytesReceived.add(received);
+    input.recordRead(received);
+    input.commit(inPlace);
+    noteActivity(c);
+
+    uint64_t receivedAt = cpuTicks();
+    if (!processInput(c, receivedAt))
+      return (false);
+    if (received > inPlace &&
+        !feedInput(c, &_readScratch[0], received - inPlace, receivedAt))
+      return (false);
+
+    if (received < iov[0].iov_len + iov[1].iov_len && !hangup)
+      return (true); // drained
+    budget -= received;
+    if (budget == 0) {
+      if (_loop->isEdgeTriggered())
+        deferRead(c);
+      return (true);
+    }
+  }
+}
+
+/**
+ * @brief Feeds bytes the backend already received (io_uring provided
+ * buffers) into the client's input buffer.
+ * @return false if the client was removed.
+ */
+bool Reactor::handleClientData(Client *c, const char *data, size_t length) {
+  metrics().recvBytes.observe(length);
+  metrics().bytesReceived.add(length);
+  noteActivity(c);
+  return feedInput(c, data, length, cpuTicks());
+}
+
+/**
+ * @brief Copies received bytes into the client's input buffer a slice at
+ * a time, running the complete lines after each slice.
+ * @return false if the client was removed.
+ */
+bool Reactor::feedInput(Client *c, const char *data, size_t length,
+                        uint64_t receivedAt) {
+  InputBuffer &input = c->getInput();
+  while (length > 0) {
+    size_t taken = input.append(data, length);
+    data += taken;
+    length -= taken;
+    if (!processInput(c, receivedAt))
+      return (false);
+  }
+  return (true);
+}
+
+/**
+ * @brief Parks a client whose read budget ran out before its socket was
+ * drained (edge-triggered backends only).
+ */
+void Reactor::deferRead(Client *c) {
+  if (c->isReadPending())
+    return;
+  c->setReadPending(true);
+  _readPending.push_back(c->getFd());
+}
+
+/**
+ * @brief Reads the clients parked by deferRead() again, with a fresh
+ * budget each. Their hangup may have been reported with the event that
+ * parked them, so they are read until EAGAIN.
+ */
+void Reactor::resumeReads() {
+  _resuming.swap(_readPending);
+  for (size_t i = 0; i < _resuming.size(); ++i) {
+    Client *client = _clients.get(_resuming[i]);
+    if (!client || !client->isReadPending())
+      continue; // disconnected (or its fd reused) since it was parked
+    client->setReadPending(false);
+    handleClientRead(client, true);
+  }
+  _resuming.clear();
+}
+
+/**
+ * @brief Runs every complete buffered line of a client as a command.
+ *
+ * Lines are views into the input buffer; they stay valid while commands
+ * run because nothing is received for this client in the meantime. A
+ * client that fills the whole buffer without a newline can never finish
+ * its line and is disconnected.
+ *
+ * Each line is charged its command's flood cost. Once the client's bucket
+ * is empty the line is put back and the client is throttled; if its
+ * deferred input then grows past --flood-queue bytes it is disconnected
+ * with "Excess Flood".
+ *
+ * @param receivedAt cpuTicks() when the bytes were read, for the
+ * dispatch delay metric (0: not recorded).
+ * @return false if the client was removed.
+ */
+bool Reactor::processInput(Client *c, uint64_t receivedAt) {
+  int fd = c->getFd();
+  InputBuffer &input = c->getInput();
+  std::string_view line;
+
+  while (input.nextLine(line)) {
+    if (_floodStep && !hasFloodCredit(c)) {
+      input.unread(line);
+      throttle(c);
+      break;
+    }
+    unsigned cost = _server->handleCommand(c, line, receivedAt);
+    if (_clients.get(fd) != c)
+      return (false); // QUIT removed the client
+    if (_floodStep)
+      chargeFlood(c, cost);
+  }
+
+  if (c->isThrottled() && input.size() > _server->_config.floodQueue) {
+    metrics().floodDisconnects.add();
+    rejectClient(c, "Excess Flood");
+    return (false);
+  }
+  if (input.overflowed()) {
+    rejectClient(c, "Input line too long");
+    return (false);
+  }
+  return (true);
+}
+
+/**
+ * @brief Sends queued output until the queue is empty or the socket is full.
+ *
+ * Each sendmsg() gathers up to IOV_MAX queued lines straight from their
+ * shared buffers, so a backlog drains in one syscall without copying.
+ * Write interest is armed only when the kernel buffer is full and dropped
+ * again once everything is sent. A call that took only part of a queue it
+ * was handed whole means the buffer is full: write interest is armed
+ * right away instead of asking again just to be told EAGAIN.
+ *
+ * A completion backend gets one SENDMSG in flight per client instead; its
+ * completion comes back as a writable event and lands here again for the
+ * rest.
+ */
+void Reactor::handleClientWrite(Client *client) {
+  int fd = client->getFd();
+  metrics().outputQueueBytes.observe(client->getOutputBufferSize());
+  client->updateSendqPeak();
+
+  if (_loop->completesIo()) {
+    if (client->hasPendingSend() && !_loop->sendInFlight(fd))
+      _loop->submitSend(fd, client->getoutputBuffer());
+    return;
+  }
+
+  if (_iov.empty())
+    _iov.resize(IOV_MAX);
+  while (client->hasPendingSend()) {
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &_iov[0];
+    msg.msg_iovlen = client->fillIovec(&_iov[0], _iov.size());
+    bool wholeQueue = msg.msg_iovlen < _iov.size();
+
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      metrics().sendBytes.observe(0);
+      _loop->setWritable(fd, true); // resume on the next write event
+      return;
+    }
+    if (sent <= 0)
+      return; // socket error: reported as a read event / hangup
+    client->consumeBytes(sent);
+    metrics().sendBytes.observe(sent);
+    metrics().bytesSent.add(sent);
+    if (wholeQueue && client->hasPendingSend()) {
+      _loop->setWritable(fd, true); // short write: the buffer is full
+      return;
+    }
+  }
+  _loop->setWritable(fd, false);
+}
+
+/**
+ * @brief Disconnects the clients exceedSendq() marked. Dropping one may
+ * queue output to others and mark them in turn; those are left on
+ * _sendqExceeded for the caller's next pass.
+ */
+void Reactor::dropSendqExceeded() {
+  _resuming.swap(_sendqExceeded);
+  for (size_t i = 0; i < _resuming.size(); ++i) {
+    Client *client = _clients.get(_resuming[i]);
+    if (client && client->isSendqExceeded())
+      rejectClient(client, "SendQ exceeded");
+  }
+  _resuming.clear();
+}
+
+/**
+ * @brief Disconnects a client for misbehaving, with a best-effort ERROR
+ * line. The line is only written when nothing else is queued, so it
+ * never lands in the middle of a partially sent reply.
+ */
+void Reactor::rejectClient(Client *c, const std::string &reason) {
+  int fd = c->getFd();
+  if (!c->hasPendingSend()) {
+    std::string error = "ERROR :" + reason + "\r\n";
+    ssize_t n = send(fd, error.data(), error.size(), MSG_NOSIGNAL);
+    (void)n; // the connection is closed either way
+  }
+  dropClient(fd);
+}
+
+/**
+ * @brief Disconnects a client after a read error or EOF.
+ */
+void Reactor::dropClient(int fd) {
+  std::unique_lock<std::shared_mutex> lock(_server->_stateLock);
+  _server->removeClient(fd);
+}
+
+/**
+ * @brief Final step of a disconnect, run by Server::removeClient once the
+ * client is gone from all shared state: stop polling, close, free.
+ */
+void Reactor::releaseClient(int fd) {
+  Client *client = _clients.erase(fd);
+  if (!client)
+    return;
+
+  removePollFd(fd);
+  client->clearOutputBuffer(); // off the reactor's queued total
+  _clientPool.destroy(client);
+  close(fd);
+  metrics().connectionsClosed.add();
+  metrics().clients.add(-1);
+}
@@ -17,19 +17,27 @@
  */
 
 #include "../../includes/Server.hpp"
+#include "../../includes/Casemap.hpp"
 #include "../../includes/Channel.hpp"
+#include "../../includes/Reactor.hpp"
 #include "../../includes/Client.hpp"
 #include "../../includes/CommandHandler.hpp"
+#include "../../includes/CommandTable.hpp"
+#include "../../includes/Metrics.hpp"
 #include "../../includes/Parser.hpp"
 #include "../../includes/Replies.hpp"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cctype>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
+#include <csignal>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
+#include <pthread.h>
 #include <stdexcept>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -43,9 +51,16 @@
  * to an object. So it is essentially a global variable but under Server
  * namespace (which is why _signal is used as static bool here).
  * This can be accessed by any function using Server::_signal.
+ * It is atomic because every reactor thread polls it.
  */
 
-bool Server::_signal = false;
+std::atomic<bool> Server::_signal(false);
+
+/* @brief
+ * Reactor whose eventfd the signal handler pokes, so a signal that lands
+ * between the _signal check and the next wait() still interrupts it.
+ */
+std::atomic<Reactor *> Server::_signalTarget(NULL);
 
 /* @brief
  * This signal handler will be called by OS whenever a signal input is detected.
@@ -59,6 +74,9 @@ void Server::signalHandler(int signum) {
   (void)signum; // Silence unused warning
   std::cout << "\nSignal received! Shutting down..." << std::endl;
   Server::_signal = true; // Flip the switch
+  Reactor *target = Server::_signalTarget;
+  if (target)
+    target->wake(); // a single write(): async-signal-safe
 }
 
 /* ============================= */
@@ -68,33 +86,36 @@ void Server::signalHandler(int signum) {
 /**
  * @brief Constructs the Server object with the given port and password.
  */
-Server::Server(const std::string &port, const std::string &password)
-    : _port(port), _password(password), _listenFd(-1) {}
+Server::Server(const std::string &port, const std::string &password,
+               const ServerConfig &config)
+    : _port(port), _password(password), _config(config), _nextClientId(0) {}
 
 /**
  * @brief Destructor cleans all client and channel maps and closes the server
  * socket.
  */
 Server::~Server() {
-  // 1. Close all client sockets and free memory
-  for (std::map<int, Client *>::iterator it = _clients.begin();
-       it != _clients.end(); ++it) {
-    close(it->first);  // Close the socket
-    delete it->second; // Free the Client object
+  // 1. Close all client sockets and hand the Clients back to their pools
+  for (int fd = 0; fd < _clients.capacity(); ++fd) {
+    Client *client = _clients.get(fd);
+    if (client)
+      client->getOwner()->releaseClient(fd);
   }
   _clients.clear();
 
-  // 2. Free all Channel objects
+  // 2. Free all Channel objects, with those retired since the reactors'
+  // last quiescent state
+  rcu().drain();
   for (std::map<std::string, Channel *>::iterator it = _channels.begin();
        it != _channels.end(); ++it) {
-    delete it->second;
+    _channelPool.destroy(it->second);
   }
   _channels.clear();
 
-  // 3. Close the listener socket
-  if (_listenFd != -1) {
-    close(_listenFd);
-  }
+  // 3. Close the listener sockets and event backends
+  for (size_t i = 0; i < _reactors.size(); ++i)
+    delete _reactors[i];
+  _reactors.clear();
 
   std::cout << "Server shutdown: All resources freed." << std::endl;
 }
@@ -103,12 +124,53 @@ Server::~Server() {
  * @brief Starts the IRC server.
  *
  * Steps:
- *  - Initialize listening socket
- *  - Enter main poll loop
+ *  - Create one Reactor per configured thread and bind its listener
+ *  - Pre-size the object pools (--reserve-clients / --reserve-channels)
+ *  - Start reactors 1..N-1 on their own threads with shutdown signals
+ *    blocked, so only the main thread is interrupted by Ctrl+C
+ *  - Run reactor 0 on the main thread until a signal arrives
+ *  - Wake and join the other reactors
+ *  - Print the per-command latency report
  */
 void Server::run() {
-  initSocket();
-  mainLoop();
+  ticksPerNs(); // pins the reference point of the tick calibration
+
+  for (int i = 0; i < _config.threads; ++i) {
+    _reactors.push_back(new Reactor(this, i));
+    _reactors.back()->initSocket();
+    // the kernel spreads connections evenly, so split the reservation
+    _reactors.back()->reserveClients(
+        (_config.reserveClients + _config.threads - 1) / _config.threads);
+  }
+  _channelPool.reserve(_config.reserveChannels);
+  std::cout << "Reactors: " << _config.threads << std::endl;
+
+  sigset_t blocked, previous;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGINT);
+  sigaddset(&blocked, SIGQUIT);
+  sigaddset(&blocked, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+  for (size_t i = 1; i < _reactors.size(); ++i)
+    _reactors[i]->start();
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  _signalTarget = _reactors[0];
+  _reactors[0]->mainLoop();
+  _signalTarget = NULL;
+
+  for (size_t i = 1; i < _reactors.size(); ++i) {
+    _reactors[i]->wake();
+    _reactors[i]->join();
+  }
+
+  std::vector<std::string> latency;
+  reportLatency(latency);
+  if (latency.size() > 1) {
+    std::cout << "Command latency:" << std::endl;
+    for (size_t i = 0; i < latency.size(); ++i)
+      std::cout << "  " << latency[i] << std::endl;
+  }
 }
 
 /* ============================= */
@@ -121,249 +183,106 @@ void Server::run() {
 const std::string &Server::getPassword() const { return _password; }
 
 /* ============================= */
-/*         SOCKET SETUP          */
+/*     COMMAND DISPATCHING       */
 /* ============================= */
 
 /**
- * @brief Initializes the listening socket.
+ * @brief Parses an IRC command and dispatches it under the state lock
+ * its descriptor asks for.
  *
- * Steps:
- *  - Create IPv4 TCP socket
- *  - Enable SO_REUSEADDR
- *  - Set non-blocking mode
- *  - Bind to the configured port
- *  - Listen for connections
- *  - Add to poll list
- */
-void Server::initSocket() {
-  _listenFd = socket(AF_INET, SOCK_STREAM, 0);
-  if (_listenFd < 0)
-    throw std::runtime_error("socket() failed");
-
-  int yes = 1; // Enable and Disable switch
-  setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-
-  // non-blocking I/O for poll-based event loop
-  fcntl(_listenFd, F_SETFL, O_NONBLOCK);
-
-  sockaddr_in addr;
-  std::memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  addr.sin_addr.s_addr = INADDR_ANY;
-  addr.sin_port = htons(std::atoi(_port.c_str()));
-
-  if (bind(_listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
-    throw std::runtime_error("bind() failed");
-
-  // SOMAXCONN = max number of queued pending connections (system-dependent)
-  if (listen(_listenFd, SOMAXCONN) < 0)
-    throw std::runtime_error("listen() failed");
-
-  addPollFd(_listenFd);
-}
-
-/* ============================= */
-/*           MAIN LOOP           */
-/* ============================= */
-
-/**
- * @brief Main poll loop handling all socket activity.
+ * The command is looked up in CommandTable (case-insensitive, no
+ * allocation); unknown commands are ignored. PRIVMSG, PING, PONG and OPER
+ * take no lock: they read only the sender and the RCU-published indexes,
+ * so the message path never waits for a writer. WHOIS and STATS take it
+ * in shared mode; anything that changes channels, nicknames or the client
+ * directory takes it exclusively.
  *
- * poll() watches an array of file descriptors and sets the 'revents' field
- * when something happens (e.g. data is ready to read). When poll() returns,
- * we scan the vector to see which fd triggered the event.
- */
-void Server::mainLoop() {
-  while (_signal == false) {
-    // === PHASE 1: PREPARE POLLFDS ===
-    // Update events flags based on buffer status
-    for (size_t i = 0; i < _pollfds.size(); i++) {
-      if (_pollfds[i].fd == _listenFd)
-        continue; // Listener is read-only
-
-      if (_clients.count(_pollfds[i].fd)) {
-        Client *c = _clients[_pollfds[i].fd];
-        if (c->hasPendingSend())
-          _pollfds[i].events = POLLIN | POLLOUT; // Needs to write
-        else
-          _pollfds[i].events = POLLIN; // Only reading
-      }
-    }
-
-    // === PHASE 2: WAIT ===
-    if (poll(_pollfds.data(), _pollfds.size(), -1) < 0) {
-      if (_signal)
-        break;
-      throw std::runtime_error("poll() failed");
-    }
-
-    // === PHASE 3: PROCESS ===
-    for (size_t i = 0; i < _pollfds.size(); i++) {
-      // 1. Listener
-      if (_pollfds[i].fd == _listenFd && (_pollfds[i].revents & POLLIN)) {
-        acceptNewClient();
-      }
-      // 2. Client Operations
-      else {
-        int fd = _pollfds[i].fd;
-        if (_clients.count(_pollfds[i].fd)) {
-          Client *client = _clients[fd];
-
-          // READ (Incoming)
-          if (_pollfds[i].revents & POLLIN) {
-            if (!handleClientRead(i)) {
-              --i;      // Client removed, stay at this index
-              continue; // Don't try to write to a dead client
-            }
-          }
-
-          // WRITE (Outgoing)
-          if (_pollfds[i].revents & POLLOUT) {
-            std::string msg = client->peekOutputBuffer();
-            ssize_t sent = send(fd, msg.c_str(), msg.size(), 0);
-            if (sent > 0)
-              client->consumeBytes(sent);
-          }
-        }
-      }
-    }
-  }
-}
-
-/* ============================= */
-/*       POLL FD MANAGEMENT      */
-/* ============================= */
-
-/**
- * @brief Adds a file descriptor to poll monitoring.
- */
-void Server::addPollFd(int fd) {
-  pollfd pfd;
-  pfd.fd = fd;
-  pfd.events = POLLIN;
-  pfd.revents = 0;
-  _pollfds.push_back(pfd);
-}
-
-/**
- * @brief Removes a file descriptor from poll monitoring.
- */
-void Server::removePollFd(int fd) {
-  for (size_t i = 0; i < _pollfds.size(); ++i) {
-    if (_pollfds[i].fd == fd) {
-      _pollfds.erase(_pollfds.begin() + i);
-      break;
-    }
-  }
-}
-
-/* ============================= */
-/*       MESSAGE EXTRACTION      */
-/* ============================= */
-
-/**
- * @brief Extracts complete IRC messages from a client's buffer.
+ * The handler's wall time (from taking the lock) is recorded per command,
+ * and, when receivedAt (cpuTicks() at the read) is given, the delay
+ * between reading the line and starting its handler.
  *
- * Splits on "\r\n" and returns each line as a separate IRC command.
- * Any partial data at the end is left in the buffer.
+ * @return The line's flood control cost: the descriptor's, or 1 for an
+ * unknown command.
  */
-std::vector<std::string> Server::extractMessages(Client *client) {
-  std::vector<std::string> messages;
-  std::string &buffer = client->getBufferRef();
-
-  while (true) {
-    // 1. Find the newline
-    size_t pos = buffer.find('\n');
-    if (pos == std::string::npos)
-      break;
-
-    // 2. Extract the message (substring before \n)
-    std::string msg = buffer.substr(0, pos);
-
-    // 3. Handle optional Carriage Return (\r)
-    // If the char before \n is \r, remove it.
-    if (!msg.empty() && msg[msg.length() - 1] == '\r') {
-      msg.erase(msg.length() - 1);
-    }
-
-    messages.push_back(msg);
+unsigned Server::handleCommand(Client *client, std::string_view msg,
+                               uint64_t receivedAt) {
+  ParsedCommand cmd = Parser::parse(msg);
+  const CommandDescriptor *desc = CommandTable::find(cmd.command);
+  if (!desc) {
+    metrics().unknownCommands.add();
+    return 1;
+  }
 
-    // 4. Remove processed line from buffer (pos + 1 to include the \n)
-    buffer.erase(0, pos + 1);
+  ServerMetrics &m = metrics();
+  size_t index = CommandTable::indexOf(*desc);
+  m.messagesIn[index].add();
+  uint64_t queuedBefore = ServerMetrics::queuedLines;
+  uint64_t started;
+
+  if (desc->lock == LOCK_NONE) {
+    started = cpuTicks();
+    dispatchCommand(client, *desc, cmd);
+  } else if (desc->lock == LOCK_SHARED) {
+    std::shared_lock<std::shared_mutex> lock(_stateLock);
+    started = cpuTicks();
+    dispatchCommand(client, *desc, cmd);
+  } else {
+    std::unique_lock<std::shared_mutex> lock(_stateLock);
+    started = cpuTicks();
+    dispatchCommand(client, *desc, cmd);
   }
-  return messages;
+  LatencyHistogram *latency = m.latency.local();
+  latency[index].observe(cpuTicks() - started);
+  if (receivedAt)
+    latency[ServerMetrics::DISPATCH_DELAY].observe(started - receivedAt);
+  // output queued while the handler ran is charged to this command
+  m.messagesOut[index].add(ServerMetrics::queuedLines - queuedBefore);
+  return desc->cost;
 }
 
-/* ============================= */
-/*     COMMAND DISPATCHING       */
-/* ============================= */
-
 /**
- * @brief Parses and dispatches an IRC command.
- * Enforces registration: before PASS/NICK/USER are done, most commands
- * return ERR_NOTREGISTERED.
+ * @brief Runs a command's handler once its descriptor's preconditions hold.
+ * Enforces registration (before PASS/NICK/USER are done, most commands
+ * return ERR_NOTREGISTERED) and the minimum parameter count. Errors are
+ * queued on the client itself, which is safe without the state lock.
  */
-void Server::handleCommand(Client *client, const std::string &msg) {
-  ParsedCommand cmd = Parser::parse(msg);
-
-  // Normalize command name to uppercase
-  std::string name = cmd.command;
-  for (size_t i = 0; i < name.size(); i++) {
-    name[i] =
-        static_cast<char>(std::toupper(static_cast<unsigned char>(name[i])));
+void Server::dispatchCommand(Client *client, const CommandDescriptor &desc,
+                             const ParsedCommand &cmd) {
+  // Block everything else until registration is complete
+  if (desc.requiresRegistration && !client->isAuthenticated()) {
+    client->queueMessage(makeReply(ERR_NOTREGISTERED));
+    return;
   }
 
-  // Commands that are allowed even if the client is not fully registered
-  bool alwaysAllowed = (name == "PASS" || name == "NICK" || name == "USER" ||
-                        name == "PING" || name == "PONG" || name == "QUIT");
-
-  // Block everything else until registration is complete
-  if (!alwaysAllowed && !client->isAuthenticated()) {
-    sendReply(client->getFd(), ERR_NOTREGISTERED);
+  if (cmd.params.size() < desc.minParams) {
+    client->queueMessage(makeReply(ERR_NEEDMOREPARAMS, desc.name));
     return;
   }
 
-  if (name == "PASS")
-    CommandHandler::handlePASS(this, client, cmd);
-  else if (name == "NICK")
-    CommandHandler::handleNICK(this, client, cmd);
-  else if (name == "USER")
-    CommandHandler::handleUSER(this, client, cmd);
-  else if (name == "JOIN")
-    CommandHandler::handleJOIN(this, client, cmd);
-  else if (name == "PART")
-    CommandHandler::handlePART(this, client, cmd);
-  else if (name == "PRIVMSG")
-    CommandHandler::handlePRIVMSG(this, client, cmd);
-  else if (name == "PING")
-    CommandHandler::handlePING(this, client, cmd);
-  else if (name == "PONG")
-    CommandHandler::handlePONG(this, client, cmd);
-  else if (name == "KICK")
-    CommandHandler::handleKICK(this, client, cmd);
-  else if (name == "MODE")
-    CommandHandler::handleMODE(this, client, cmd);
-  else if (name == "TOPIC")
-    CommandHandler::handleTOPIC(this, client, cmd);
-  else if (name == "INVITE")
-    CommandHandler::handleINVITE(this, client, cmd);
-  else if (name == "WHOIS")
-    CommandHandler::handleWHOIS(this, client, cmd);
-  else if (name == "QUIT")
-    CommandHandler::handleQUIT(this, client, cmd);
+  desc.calls->fetch_add(1, std::memory_order_relaxed);
+  desc.handler(this, client, cmd);
 }
 
 /* ============================= */
 /*      REGISTRATION HELPERS     */
 /* ============================= */
 
-bool Server::nicknameInUse(const std::string &nick) const {
-  for (std::map<int, Client *>::const_iterator it = _clients.begin();
-       it != _clients.end(); ++it) {
-    if (it->second->getNickname() == nick)
-      return true;
-  }
-  return false;
+/**
+ * @brief Changes a client's nickname and keeps the index and the NAMES
+ * entries of its channels in sync.
+ * Caller holds _stateLock exclusively and has checked that no other
+ * client holds the nick (getClientByNick()).
+ */
+void Server::setClientNick(Client *client, const std::string &nick) {
+  std::string old = client->getNickname();
+  if (!old.empty())
+    _nicks.erase(ircCasefold(old));
+  client->setNickname(nick);
+  _nicks.insert(ircCasefold(nick), client->getRoute());
+
+  const std::vector<Channel *> &joined = client->getJoinedChannels();
+  for (size_t i = 0; i < joined.size(); ++i)
+    joined[i]->renameMember(client, old);
 }
 
 bool Server::isClientFullyRegistered(Client *client) const {
@@ -379,10 +298,16 @@ bool Server::isClientFullyRegistered(Client *client) const {
 }
 
 /**
- * @brief Sends the initial welcome numeric to a fully registered client.
+ * @brief Sends the initial welcome numerics to a fully registered client:
+ * RPL_WELCOME, then RPL_ISUPPORT so it knows how nicknames compare and
+ * how long they may be.
  */
 void Server::sendWelcome(Client *client) {
-  sendReply(client->getFd(), RPL_WELCOME(client->getNickname()));
+  sendReply(client->getFd(), makeReply(RPL_WELCOME, client->getNickname()));
+  std::string tokens = "CASEMAPPING=" SERVER_CASEMAPPING " NICKLEN=" +
+                       std::to_string(SERVER_NICKLEN);
+  sendReply(client->getFd(),
+            makeReply(RPL_ISUPPORT, client->getNickname(), tokens));
 }
 
 /**
@@ -399,6 +324,7 @@ void Server::tryRegister(Client *client) {
     return;
 
   client->setAuthenticated(true);
+  client->setSendqLimit(_config.sendQueue);
   sendWelcome(client);
 }
 
@@ -412,15 +338,28 @@ void Server::tryRegister(Client *client) {
  * This is a small helper around send() used by the reply macros.
  */
 void Server::sendReply(int fd, const std::string &msg) {
-  std::map<int, Client *>::iterator it = _clients.find(fd);
-  if (it != _clients.end()) {
-    queueMessage(it->second, msg);
+  Client *client = _clients.get(fd);
+  if (client) {
+    queueMessage(client, msg);
     return;
   }
   // Fallback for early replies before a Client object is tracked
   send(fd, msg.c_str(), msg.size(), MSG_NOSIGNAL);
 }
 
+/**
+ * @brief Same for a line built by makeReply(): the client's queue takes a
+ * reference to it, the bytes are not copied again.
+ */
+void Server::sendReply(int fd, const SharedLine &line) {
+  Client *client = _clients.get(fd);
+  if (client) {
+    client->queueMessage(line);
+    return;
+  }
+  send(fd, line->data(), line->size(), MSG_NOSIGNAL);
+}
+
 /**
  * @brief Queues a message for deferred sending via poll-driven writes.
  */
@@ -429,3 +368,240 @@ void Server::queueMessage(Client *client, const std::string &msg) {
     return;
   client->queueMessage(msg);
 }
+
+/* ============================= */
+/*           STATISTICS          */
+/* ============================= */
+
+/**
+ * @brief Collects pool occupancy for STATS p: the per-reactor Client and
+ * input buffer pools, then the shared Channel pool.
+ */
+void Server::reportPools(std::vector<std::string> &lines) const {
+  for (size_t i = 0; i < _reactors.size(); ++i)
+    _reactors[i]->reportPools(lines);
+  lines.push_back("channels: " + std::to_string(_channelPool.inUse()) +
+                  " used, " + std::to_string(_channelPool.capacity()) +
+                  " allocated, " + std::to_string(_channelPool.peak()) +
+                  " peak");
+}
+
+/**
+ * @brief Appends one line per command: lines received and lines queued
+ * while its handler ran. Reads atomic counters only.
+ */
+void Server::reportCommands(std::vector<std::string> &lines) const {
+  ServerMetrics &m = metrics();
+  for (size_t i = 0; i < CommandTable::size() && i < m.MAX_COMMANDS; ++i) {
+    lines.push_back(std::string(CommandTable::at(i).name) + " in " +
+                    std::to_string(m.messagesIn[i].value()) + " out " +
+                    std::to_string(m.messagesOut[i].value()));
+  }
+  lines.push_back("unknown in " +
+                  std::to_string(m.unknownCommands.value()));
+}
+
+static std::string formatTicks(uint64_t ticks, double perNs) {
+  double ns = ticks / perNs;
+  char buf[32];
+  if (ns < 1000)
+    std::snprintf(buf, sizeof(buf), "%.0fns", ns);
+  else if (ns < 1000000)
+    std::snprintf(buf, sizeof(buf), "%.1fus", ns / 1e3);
+  else
+    std::snprintf(buf, sizeof(buf), "%.1fms", ns / 1e6);
+  return buf;
+}
+
+static std::string latencyLine(const std::string &name,
+                               const LatencyHistogram &h, double perNs) {
+  uint64_t n = h.count();
+  return name + " n=" + std::to_string(n) +
+         " mean=" + formatTicks(n ? h.sum() / n : 0, perNs) +
+         " p50=" + formatTicks(h.quantile(0.50), perNs) +
+         " p99=" + formatTicks(h.quantile(0.99), perNs) +
+         " p999=" + formatTicks(h.quantile(0.999), perNs);
+}
+
+/**
+ * @brief Appends the handler time distribution of every command that ran,
+ * then the read-to-dispatch delay. Used by STATS l and at shutdown.
+ */
+void Server::reportLatency(std::vector<std::string> &lines) const {
+  ServerMetrics &m = metrics();
+  double perNs = ticksPerNs();
+  for (size_t i = 0; i < CommandTable::size() && i < m.MAX_COMMANDS; ++i) {
+    LatencyHistogram h;
+    m.latency.collect(i, h);
+    if (h.count())
+      lines.push_back(
+          latencyLine(std::string(CommandTable::at(i).name), h, perNs));
+  }
+  LatencyHistogram delay;
+  m.latency.collect(ServerMetrics::DISPATCH_DELAY, delay);
+  lines.push_back(latencyLine("dispatch-delay", delay, perNs));
+}
+
+/* Clients listed with their send queue peak on the metrics endpoint */
+static const size_t SENDQ_REPORT = 20;
+
+/**
+ * @brief Appends the send queue totals and the distribution of the
+ * per-client high-water marks. Used by STATS q, which any registered
+ * user may run, so no client is named: which users lag is only shown on
+ * the localhost metrics endpoint (see renderMetrics). The caller holds
+ * _stateLock, at least shared.
+ */
+void Server::reportSendq(std::vector<std::string> &lines) const {
+  size_t queued = 0;
+  for (size_t i = 0; i < _reactors.size(); ++i)
+    queued += _reactors[i]->getQueuedBytes();
+  lines.push_back("queued " + std::to_string(queued) + " limit " +
+                  std::to_string(_config.sendQueueTotal) + " disconnects " +
+                  std::to_string(metrics().sendqDisconnects.value()));
+
+  Histogram peaks(metrics().sendqPeak.buckets());
+  size_t max = 0;
+  size_t nearLimit = 0; // peak at half the client's limit or more
+  for (int fd = 0; fd < _clients.capacity(); ++fd) {
+    const Client *c = _clients.get(fd);
+    if (!c)
+      continue;
+    size_t peak = c->getSendqPeak();
+    peaks.observe(peak);
+    max = std::max(max, peak);
+    if (peak * 2 >= c->getSendqLimit())
+      ++nearLimit;
+  }
+  // percentile() is a bucket bound; it must not read above the real max
+  std::string line = "clients " + std::to_string(peaks.count()) + " peak";
+  static const double QUANTILES[] = {0.5, 0.9, 0.99};
+  static const char *const NAMES[] = {" p50 ", " p90 ", " p99 "};
+  for (size_t i = 0; i < 3; ++i)
+    line += NAMES[i] + std::to_string(std::min<uint64_t>(
+                           peaks.percentile(QUANTILES[i]), max));
+  lines.push_back(line + " max " + std::to_string(max) + " near-limit " +
+                  std::to_string(nearLimit));
+}
+
+/* Escapes a Prometheus label value; nicks may contain a backslash */
+static std::string labelValue(const std::string &value) {
+  std::string out;
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (value[i] == '\\' || value[i] == '"')
+      out += '\\';
+    out += value[i];
+  }
+  return out;
+}
+
+/**
+ * @brief Prometheus series for the clients with the highest send queue
+ * high-water marks (at most SENDQ_REPORT of them): peak and class limit.
+ * Works on a snapshot, so no lock is needed; reorders its samples.
+ */
+void Server::renderSendqClients(MetricsSnapshot &snap, std::string &out) {
+  std::vector<SendqSample> &clients = snap.clients;
+  size_t shown = std::min(clients.size(), SENDQ_REPORT);
+  std::partial_sort(clients.begin(), clients.begin() + shown, clients.end(),
+                    [](const SendqSample &a, const SendqSample &b) {
+                      return a.peak > b.peak;
+                    });
+
+  std::string peaks, limits;
+  for (size_t i = 0; i < shown; ++i) {
+    const SendqSample &c = clients[i];
+    std::string label = "{client=\"" + labelValue(c.name) + "\"} ";
+    peaks += "ircserv_top_client_sendq_peak_bytes" + label +
+             std::to_string(c.peak) + "\n";
+    limits += "ircserv_top_client_sendq_limit_bytes" + label +
+              std::to_string(c.limit) + "\n";
+  }
+  out += "# HELP ircserv_top_client_sendq_peak_bytes Send queue high-water "
+         "mark of the clients with the largest ones.\n"
+         "# TYPE ircserv_top_client_sendq_peak_bytes gauge\n";
+  out += peaks;
+  out += "# HELP ircserv_top_client_sendq_limit_bytes Send queue limit of "
+         "the same clients.\n"
+         "# TYPE ircserv_top_client_sendq_limit_bytes gauge\n";
+  out += limits;
+}
+
+/**
+ * @brief Copies what the derived metrics are computed from: channel
+ * sizes, per-client send queue peaks and limits (with a name for the
+ * top list) and the queued output. Only plain copies, so the caller's
+ * lock (_stateLock, at least shared) is held as briefly as possible.
+ */
+void Server::snapshotMetrics(MetricsSnapshot &snap) const {
+  snap.channelSizes.reserve(_channels.size());
+  for (std::map<std::string, Channel *>::const_iterator it =
+           _channels.begin();
+       it != _channels.end(); ++it)
+    snap.channelSizes.push_back(it->second->getClients().size());
+
+  snap.clients.reserve(_clients.size());
+  for (int fd = 0; fd < _clients.capacity(); ++fd) {
+    const Client *c = _clients.get(fd);
+    if (!c)
+      continue;
+    SendqSample sample;
+    sample.peak = c->getSendqPeak();
+    sample.limit = c->getSendqLimit();
+    sample.name = c->getNickname().empty() ? "fd" + std::to_string(fd)
+                                           : c->getNickname();
+    snap.clients.push_back(sample);
+  }
+
+  snap.queued = 0;
+  for (size_t i = 0; i < _reactors.size(); ++i)
+    snap.queued += _reactors[i]->getQueuedBytes();
+}
+
+/**
+ * @brief Recomputes the metrics that are derived from shared state
+ * (channel count and sizes, queued output and its high-water marks)
+ * from a snapshot, instead of updating them on the hot path.
+ */
+void Server::applyMetrics(const MetricsSnapshot &snap) {
+  ServerMetrics &m = metrics();
+  Histogram members(m.channelMembers.buckets());
+  for (size_t i = 0; i < snap.channelSizes.size(); ++i)
+    members.observe(snap.channelSizes[i]);
+  m.channelMembers.assign(members);
+  m.channels.set(static_cast<int64_t>(snap.channelSizes.size()));
+
+  Histogram peaks(m.sendqPeak.buckets());
+  for (size_t i = 0; i < snap.clients.size(); ++i)
+    peaks.observe(snap.clients[i].peak);
+  m.sendqPeak.assign(peaks);
+  m.sendqBytes.set(static_cast<int64_t>(snap.queued));
+}
+
+/**
+ * @brief Refreshes the derived metrics; the caller holds _stateLock, at
+ * least shared.
+ */
+void Server::refreshMetrics() const {
+  MetricsSnapshot snap;
+  snapshotMetrics(snap);
+  applyMetrics(snap);
+}
+
+/**
+ * @brief Prometheus text for the metrics endpoint.
+ *
+ * Only the snapshot is taken under _stateLock; histograms and the text
+ * are built after it is released, so a scrape holds up exclusive
+ * commands for no more than the copy.
+ */
+void Server::renderMetrics(std::string &out) const {
+  MetricsSnapshot snap;
+  {
+    std::shared_lock<std::shared_mutex> lock(_stateLock);
+    snapshotMetrics(snap);
+  }
+  applyMetrics(snap);
+  metrics().registry.renderPrometheus(out);
+  renderSendqClients(snap, out);
+}